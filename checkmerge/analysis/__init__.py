@@ -1,9 +1,13 @@
+import threading
 import typing
 
-import itertools
-
 from checkmerge import diff, ir
-from checkmerge.util.collections import remove_subsets
+from checkmerge.ir.flat import ReferenceIndex
+from checkmerge.util.collections import bitset, remove_subsets
+
+
+# Type variables
+T = typing.TypeVar('T')
 
 
 AnalysisResultGenerator = typing.Generator["AnalysisResult", None, None]
@@ -63,19 +67,91 @@ class AnalysisResult(object):
         return set(ir.Range.compress(*map(lambda n: n.source_range, self.get_changed_other_nodes())))
 
 
+class AnalysisContext(object):
+    """
+    Views of a diff result shared by all analyses of a run, such as the changed nodes and the memory operations of the
+    trees, so each view is computed once per diff result instead of once per analysis.
+
+    Views are computed on first use. Analyses can keep their own indices in the context as well (see `view()`), which
+    are then shared with other instances of the analysis on the same diff result. Views can be obtained from analyses
+    running concurrently in threads, in which case each view is still computed once.
+    """
+
+    def __init__(self, changes: diff.DiffResult):
+        """
+        :param changes: The diff result, of which the nodes are tagged with the changes (see `diff.tag_nodes()`).
+        """
+        self.changes = changes
+        self._views: typing.Dict[typing.Hashable, typing.Any] = {}
+        self._lock = threading.RLock()
+
+    @property
+    def trees(self) -> typing.Tuple[ir.Node, ...]:
+        """The diffed trees, starting with the ancestor for merges."""
+        if isinstance(self.changes, diff.MergeDiffResult):
+            return self.changes.ancestor, self.changes.base, self.changes.other
+        return self.changes.base, self.changes.other
+
+    def view(self, key: typing.Hashable, factory: typing.Callable[[], T]) -> T:
+        """
+        Returns a view of the diff result, which is computed by the given function if it is not in the context yet.
+
+        :param key: The key of the view, starting with the key of the analysis for views of a single analysis.
+        :param factory: Function computing the view.
+        :return: The view.
+        """
+        try:
+            return self._views[key]
+        except KeyError:
+            with self._lock:
+                if key not in self._views:
+                    self._views[key] = factory()
+                return self._views[key]
+
+    def changed(self, root: ir.Node) -> int:
+        """
+        :param root: A node of the tree.
+        :return: The bitset of the changed nodes of the tree, indexed by the preorder index of the nodes.
+        """
+        flat = root.flat
+        return self.view(('changed', flat), lambda: bitset((i for i, n in enumerate(flat.nodes) if n.is_changed),
+                                                           len(flat.nodes)))
+
+    def memory_operations(self, root: ir.Node) -> typing.List[ir.Node]:
+        """
+        :param root: The root of the subtree.
+        :return: The memory operations in the subtree in preorder.
+        """
+        flat, i = root.flat, root.index
+        return self.view(('memory_operations', flat, i),
+                         lambda: [n for n in flat.nodes[i:i + flat.size[i]] if n.is_memory_operation])
+
+    def references(self, root: ir.Node) -> ReferenceIndex:
+        """
+        :param root: A node of the tree.
+        :return: The index of the definitions of the tree and their uses.
+        """
+        return root.flat.references
+
+
 class Analysis(object):
     """
     Base class for analysis implementations.
+
+    Analyses of a run share an analysis context with the views of the diff result (see `AnalysisContext`). As analyses
+    may run concurrently, they must not change the trees or the diff result.
     """
     key: str = ''
     name: str = ''
     description: str = ''
 
-    def __call__(self, changes: diff.DiffResult) -> AnalysisResultGenerator:
+    def __call__(self, changes: diff.DiffResult, context: typing.Optional[AnalysisContext] = None) \
+            -> AnalysisResultGenerator:
         """
-        Runs the analysis on the provided trees and diff result. Yields an analysis result for
+        Runs the analysis on the provided trees and diff result. Yields an analysis result for every conflict found.
 
         :param changes: The diff result of the provided trees.
+        :param context: The context shared with other analyses of the diff result, created if not given.
         :return: Generator of the results of this analysis.
         """
         raise NotImplementedError()
@@ -86,9 +162,12 @@ def optimize_change_sets(change_sets: typing.Iterable[typing.Set[ir.Node]]) -> t
     Optimizes sets of changes in a number of ways to remove sets covering the same changes.
 
     Optimizations include:
-    - Nodes that are descendants of another node present in the set are replaced by that node.
+    - Nodes that are descendants of a node present in another set are replaced by the outermost such node.
     - Sets of nodes that are subsets of another set of nodes are removed.
 
+    Ancestors are found with a single sweep over the nodes of each tree in preorder, in which the subtree of a node is
+    an interval of indices (see `FlatTree`), so no pairs of sets or nodes are compared.
+
     :param change_sets: A set containing sets of changed nodes.
     :return: A generator yielding sets of changed nodes.
     """
@@ -97,15 +176,34 @@ def optimize_change_sets(change_sets: typing.Iterable[typing.Set[ir.Node]]) -> t
     # Remove duplicates before carrying out expensive algorithm
     change_sets = list(remove_subsets(change_sets))
 
-    # Iterate over all combinations of two change sets to build a replacement mapping
-    for cs1, cs2 in itertools.combinations(change_sets, 2):
-        # Iterate over all combinations of the changes in the sets
-        for c1, c2 in itertools.product(cs1, cs2):
-            # Set replacement if a node is a descendant of
-            if c1 in c2.descendants:
-                replaces[c1] = replaces.get(c2, c2)
-            elif c2 in c1.descendants:
-                replaces[c2] = replaces.get(c1, c1)
+    # The sets each node occurs in, grouped per tree
+    occurrences: typing.Dict[ir.Node, typing.Set[int]] = {}
+    for k, cs in enumerate(change_sets):
+        for node in cs:
+            occurrences.setdefault(node, set()).add(k)
+
+    trees: typing.Dict[int, typing.List[ir.Node]] = {}
+    for node in occurrences:
+        trees.setdefault(id(node.flat), []).append(node)
+
+    for nodes in trees.values():
+        nodes.sort(key=lambda n: n.index)
+
+        # Sweep in preorder, keeping the chain of enclosing nodes from the outermost inwards
+        stack: typing.List[ir.Node] = []
+        for node in nodes:
+            i = node.index
+            while stack and not stack[-1].index < i < stack[-1].index + stack[-1].size:
+                stack.pop()
+
+            # Nodes are only replaced by nodes from another set
+            sets = occurrences[node]
+            for ancestor in stack:
+                if len(sets) > 1 or occurrences[ancestor] != sets:
+                    replaces[node] = replaces.get(ancestor, ancestor)
+                    break
+
+            stack.append(node)
 
     # Carry out replacements and yield the results
     yield from remove_subsets({replaces.get(c, c) for c in cs} for cs in change_sets)
@@ -1,8 +1,9 @@
 import itertools
 import typing
 
-from checkmerge import analysis, diff, ir
+from checkmerge import analysis, diff, ir, plugin
 from checkmerge.util import collections
+from checkmerge.util.trace import tracer
 
 
 class MemoryDependenceConflict(analysis.AnalysisResult):
@@ -15,26 +16,183 @@ class MemoryDependenceConflict(analysis.AnalysisResult):
     severity: float = 1.0
 
 
+class MemoryDependenceClosure(object):
+    """
+    Reachability in the memory dependence graph of a tree, as followed by `DependenceAnalysis`.
+
+    The graph is condensed into its strongly connected components once, after which the nodes reachable from every
+    component are computed over the resulting acyclic graph as bitsets of node indices in the flat tree (see
+    `FlatTree`). Memory operations reach all of their descendants. To avoid an edge to every descendant, each node has
+    an auxiliary vertex for its subtree, which reaches the node itself and the subtree vertices of its children.
+    """
+    __slots__ = ('flat', 'changed', '_forward', '_forward_reach', '_reverse', '_reverse_reach')
+
+    def __init__(self, root: ir.Node, follow: typing.Callable[[ir.Dependency], typing.Any]):
+        """
+        :param root: A node of the tree.
+        :param follow: Filter for the dependencies to follow.
+        """
+        self.flat = flat = root.flat
+        n = len(flat)
+        nodes = flat.nodes
+
+        children: typing.List[typing.List[int]] = [[] for _ in range(n)]
+        for i in range(1, n):
+            children[flat.parent[i]].append(n + i)
+
+        memory = [node.is_memory_operation for node in nodes]
+
+        def targets(dependencies: typing.Iterable[ir.Dependency]) -> typing.List[int]:
+            return [d.node.index for d in filter(follow, dependencies)
+                    if d.node is not None and d.node.flat is flat]
+
+        def successors(direction: typing.List[typing.List[int]]) -> typing.List[typing.List[int]]:
+            return [direction[v] + children[v] if memory[v] else direction[v] for v in range(n)] + \
+                   [[u] + children[u] for u in range(n)]
+
+        forward = successors([targets(x.dependencies) for x in nodes])
+        reverse = successors([targets(x.reverse_dependencies) for x in nodes])
+        if tracer.enabled:
+            tracer.count('dependence.edges', sum(map(len, forward)) + sum(map(len, reverse)))
+
+        self._forward, self._forward_reach = self._condense(n, forward)
+        self._reverse, self._reverse_reach = self._condense(n, reverse)
+
+        #: Bitset of the changed nodes of the tree.
+        self.changed = collections.bitset((i for i, node in enumerate(nodes) if node.is_changed), len(nodes))
+
+    @staticmethod
+    def _condense(n: int, successors: typing.List[typing.List[int]]) \
+            -> typing.Tuple[typing.List[int], typing.List[int]]:
+        """
+        Condenses the graph with the given successor lists into strongly connected components using an iterative
+        version of Tarjan's algorithm, and computes the set of reachable nodes for each component.
+
+        :param n: The number of nodes, vertices from `n` onwards are auxiliary and not part of the reachable sets.
+        :param successors: The successors of every vertex.
+        :return: The component of every vertex and the bitset of reachable nodes for every component.
+        """
+        size = len(successors)
+        component = [-1] * size
+        order = [-1] * size
+        low = [0] * size
+        reach: typing.List[int] = []
+        stack: typing.List[int] = []
+        counter = 0
+
+        for start in range(size):
+            if order[start] >= 0:
+                continue
+
+            work = [(start, 0)]
+            while work:
+                v, k = work.pop()
+                if k == 0:
+                    order[v] = low[v] = counter
+                    counter += 1
+                    stack.append(v)
+
+                # Visit the next unvisited successor
+                succ = successors[v]
+                while k < len(succ):
+                    w = succ[k]
+                    k += 1
+                    if order[w] < 0:
+                        work.append((v, k))
+                        work.append((w, 0))
+                        break
+                    if component[w] < 0 and order[w] < low[v]:
+                        low[v] = order[w]
+                else:
+                    if low[v] == order[v]:
+                        # Pop the component, all components reachable from it have been completed before
+                        c = len(reach)
+                        bits = 0
+                        members = []
+                        while True:
+                            w = stack.pop()
+                            component[w] = c
+                            members.append(w)
+                            if w < n:
+                                bits |= 1 << w
+                            if w == v:
+                                break
+                        for w in members:
+                            for x in successors[w]:
+                                if component[x] != c:
+                                    bits |= reach[component[x]]
+                        reach.append(bits)
+
+                    # Propagate the low link to the parent in the walk
+                    if work:
+                        parent = work[-1][0]
+                        if low[v] < low[parent]:
+                            low[parent] = low[v]
+
+        return component, reach
+
+    def components(self, node: ir.Node) -> typing.Tuple[int, int]:
+        """The components of the given node in both directions, nodes in the same components share dependencies."""
+        return self._forward[node.index], self._reverse[node.index]
+
+    def dependencies(self, node: ir.Node) -> int:
+        """The bitset of the nodes reachable from the given node in either direction, including the node itself."""
+        i = node.index
+        return self._forward_reach[self._forward[i]] | self._reverse_reach[self._reverse[i]]
+
+    def nodes(self, bits: int) -> typing.Generator[ir.Node, None, None]:
+        """Generator for the nodes in the given bitset."""
+        digits = bin(bits)[:1:-1]
+        i = digits.find('1')
+        while i >= 0:
+            yield self.flat.nodes[i]
+            i = digits.find('1', i + 1)
+
+
 class DependenceAnalysis(analysis.Analysis):
     """
     Analysis that finds conflicting changes in two versions of the program that may affect the same memory.
     """
-    key: str = 'dependence'
-    name: str = 'Dependence analysis'
-    description: str = 'Finds changes in two versions that modify the same memory.'
+    key, name, description = plugin.DEPENDENCE_ANALYSIS
 
-    def __call__(self, changes: diff.DiffResult) -> analysis.AnalysisResultGenerator:
+    def __call__(self, changes: diff.DiffResult, context: typing.Optional[analysis.AnalysisContext] = None) \
+            -> analysis.AnalysisResultGenerator:
+        context = context or analysis.AnalysisContext(changes)
         results = []
 
+        # Closures of the trees are shared through the context, the changed nodes affected by the nodes of a component
+        # pair are computed once
+        affected_cache: typing.Dict[typing.Tuple[int, int, int], typing.Set[ir.Node]] = {}
+
+        def build_closure(n: ir.Node) -> MemoryDependenceClosure:
+            with tracer.span('dependence.closure'):
+                return MemoryDependenceClosure(n, self.is_memory_dependency)
+
+        def closure(n: ir.Node) -> MemoryDependenceClosure:
+            return context.view((self.key, 'closure', n.flat), lambda: build_closure(n))
+
+        def affected_changes(n: ir.Node) -> typing.Set[ir.Node]:
+            c = closure(n)
+            key = (id(c.flat), *c.components(n))
+            if key not in affected_cache:
+                # Union the dependencies of the mapped nodes per tree
+                affected: typing.Dict[MemoryDependenceClosure, int] = {}
+                for d in c.nodes(c.dependencies(n)):
+                    if d.mapping is not None:
+                        m = closure(d.mapping)
+                        affected[m] = affected.get(m, 0) | m.dependencies(d.mapping)
+                affected_cache[key] = {x for m, bits in affected.items() for x in m.nodes(bits & m.changed)}
+            return affected_cache[key]
+
         # Get all nodes that are of interest
-        all_nodes = itertools.chain(changes.base.subtree(), changes.other.subtree())
-        memory_nodes = filter(lambda n: n.is_memory_operation, all_nodes)
+        memory_nodes = itertools.chain(*map(context.memory_operations, (changes.base, changes.other)))
 
         # Iterate over all changed memory operations in both trees
         for node in memory_nodes:
-            # Get all nodes possibly affected by a change in this node
-            affected_nodes = {node}.union(self.get_affected(node))
-            changed_nodes = {n for n in affected_nodes if n.is_changed}
+            # Get all changed nodes possibly affected by a change in this node
+            changed_nodes = set(affected_changes(node))
+            if node.is_changed:
+                changed_nodes.add(node)
 
             # If there is one changed node there is no problem
             if len(changed_nodes) > 1:
@@ -54,6 +212,7 @@ class DependenceAnalysis(analysis.Analysis):
     def recursive_memory_dependencies(cls, node: ir.Node, reverse: bool = False) -> typing.Set[ir.Node]:
         nodes = [node]
         result = set()
+        followed = 0
 
         while len(nodes) > 0:
             # Get next node
@@ -68,10 +227,12 @@ class DependenceAnalysis(analysis.Analysis):
             # Add single-direction dependencies
             dependencies = node.reverse_dependencies if reverse else node.dependencies
             nodes.extend(d.node for d in filter(cls.is_memory_dependency, dependencies))
+            followed += len(dependencies)
 
             if node.is_memory_operation:
                 nodes.extend(node.descendants)
 
+        tracer.count('dependence.edges', followed)
         return result
 
     @classmethod
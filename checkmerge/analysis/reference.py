@@ -1,6 +1,6 @@
 import typing
 
-from checkmerge import analysis, diff, ir
+from checkmerge import analysis, diff, ir, plugin
 
 
 class ReferenceAnalysisResult(analysis.AnalysisResult):
@@ -27,17 +27,23 @@ class ReferenceAnalysis(analysis.Analysis):
     """
     Analysis that finds renamed or deleted identifiers and checks whether all references to it changed as well.
     """
-    key: str = 'reference'
-    name: str = "Reference analysis"
-    description: str = "Finds changes in versions that lead to broken references to identifiers."
+    key, name, description = plugin.REFERENCE_ANALYSIS
 
-    def __call__(self, changes: diff.DiffResult) -> analysis.AnalysisResultGenerator:
+    def __call__(self, changes: diff.DiffResult, context: typing.Optional[analysis.AnalysisContext] = None) \
+            -> analysis.AnalysisResultGenerator:
         # Exit if the diff is not a three-way diff
         if not isinstance(changes, diff.MergeDiffResult):
             return
+        context = context or analysis.AnalysisContext(changes)
+
+        # The definitions and their uses are indexed once per tree
+        ancestor = changes.ancestor.flat
+        references = context.references(changes.ancestor)
 
         # Iterate over all declarations
-        for declaration in filter(lambda n: n.is_definition, changes.ancestor.subtree()):
+        for k in references.subtree(changes.ancestor.index):
+            declaration = ancestor.nodes[references.definitions[k]]
+
             # Get relevant changes in the declaration
             base_change: diff.Change = changes.base_changes_by_node.get(declaration)
             other_change: diff.Change = changes.other_changes_by_node.get(declaration)
@@ -45,7 +51,7 @@ class ReferenceAnalysis(analysis.Analysis):
             # Do analysis if there is a change
             if base_change is not None or other_change is not None:
                 # Get all uses of the declaration
-                uses = set(self.get_uses(declaration))
+                uses = [ancestor.nodes[i] for i in references.users[references.offsets[k]:references.offsets[k + 1]]]
 
                 # Get declarations in other versions
                 base_declaration = changes.base_mapping.get(declaration)
@@ -53,13 +59,24 @@ class ReferenceAnalysis(analysis.Analysis):
                 declarations = {base_declaration, other_declaration} - {None}
 
                 if base_change is not None and other_declaration is not None:
-                    other_uses = set(self.get_uses(other_declaration))
-                    conflicting_nodes = other_uses.difference(map(changes.other_mapping.get, uses)).union(declarations)
-                    yield from self.get_conflict(base_change.op, conflicting_nodes, changes)
+                    other_uses = self.get_use_set(other_declaration)
+                    mapped_uses = {changes.other_mapping.get(use) for use in uses}
+                    yield from self.get_conflict(base_change.op, (other_uses - mapped_uses) | declarations, changes)
                 if other_change is not None and base_declaration is not None:
-                    base_uses = set(self.get_uses(base_declaration))
-                    conflicting_nodes = base_uses.difference(map(changes.base_mapping.get, uses)).union(declarations)
-                    yield from self.get_conflict(other_change.op, conflicting_nodes, changes)
+                    base_uses = self.get_use_set(base_declaration)
+                    mapped_uses = {changes.base_mapping.get(use) for use in uses}
+                    yield from self.get_conflict(other_change.op, (base_uses - mapped_uses) | declarations, changes)
+
+    @staticmethod
+    def get_use_set(node: ir.Node) -> typing.Set[ir.Node]:
+        """
+        Returns the nodes using the given node from the reference index of its tree.
+
+        :param node: The node to get the uses for.
+        :return: The set of nodes referencing the given node.
+        """
+        flat = node.flat
+        return {flat.nodes[i] for i in flat.references.uses(node.index)}
 
     @classmethod
     def get_uses(cls, node: ir.Node) -> typing.Generator[ir.Node, None, None]:
@@ -2,7 +2,46 @@ import collections
 import itertools
 import typing
 
-from checkmerge import analysis, report
+from checkmerge import analysis, ir, report
+
+
+class SeverityStatistics(object):
+    """
+    Statistics about the severity of analysis results, which are updated for every result so the results do not have
+    to be kept.
+    """
+    __slots__ = ('count', 'max', 'total')
+
+    def __init__(self, items: typing.Iterable[analysis.AnalysisResult] = ()):
+        """
+        :param items: The results to start off with.
+        """
+        self.count = 0
+        self.max = None
+        self.total = 0.0
+
+        for item in items:
+            self.add(item)
+
+    @classmethod
+    def of(cls, items: typing.Union[typing.Iterable[analysis.AnalysisResult], "SeverityStatistics"]):
+        """Returns the statistics of the given results, or the given statistics."""
+        return items if isinstance(items, cls) else cls(items)
+
+    def add(self, item: analysis.AnalysisResult) -> None:
+        """
+        Updates the statistics with an analysis result.
+
+        :param item: The result to add.
+        """
+        self.count += 1
+        self.max = item.severity if self.max is None else max(self.max, item.severity)
+        self.total += item.severity
+
+    @property
+    def avg(self) -> float:
+        """The average severity."""
+        return self.total / float(self.count)
 
 
 class AnalysisResultMaxSeverityMetric(report.Metric):
@@ -13,12 +52,12 @@ class AnalysisResultMaxSeverityMetric(report.Metric):
     low = .5
     high = 1.5
 
-    def __init__(self, items: typing.List[analysis.AnalysisResult]):
+    def __init__(self, items: typing.Union[typing.List[analysis.AnalysisResult], SeverityStatistics]):
         """
         :param cls: The type of analysis result.
-        :param items: The results of the given type.
+        :param items: The results of the given type, or their statistics.
         """
-        value = max((item.severity for item in items))
+        value = SeverityStatistics.of(items).max
         super(AnalysisResultMaxSeverityMetric, self).__init__(value)
 
 
@@ -30,12 +69,12 @@ class AnalysisResultAvgSeverityMetric(report.Metric):
     low = .5
     high = 1.5
 
-    def __init__(self, items: typing.List[analysis.AnalysisResult]):
+    def __init__(self, items: typing.Union[typing.List[analysis.AnalysisResult], SeverityStatistics]):
         """
         :param cls: The type of analysis result.
-        :param items: The results of the given type.
+        :param items: The results of the given type, or their statistics.
         """
-        value = sum((item.severity for item in items)) / float(len(items))
+        value = SeverityStatistics.of(items).avg
         super(AnalysisResultAvgSeverityMetric, self).__init__(value)
 
 
@@ -46,12 +85,13 @@ class AnalysisResultMetric(report.Metric):
     low = 1
     high = 5
 
-    def __init__(self, cls: typing.Type[analysis.AnalysisResult], items: typing.List[analysis.AnalysisResult]):
+    def __init__(self, cls: typing.Type[analysis.AnalysisResult],
+                 items: typing.Union[typing.List[analysis.AnalysisResult], SeverityStatistics]):
         self.name = cls.name
-        items = list(items)
-        max_severity = AnalysisResultMaxSeverityMetric(items)
-        avg_severity = AnalysisResultAvgSeverityMetric(items)
-        super(AnalysisResultMetric, self).__init__(len(items), children=[max_severity, avg_severity])
+        statistics = SeverityStatistics.of(items)
+        max_severity = AnalysisResultMaxSeverityMetric(statistics)
+        avg_severity = AnalysisResultAvgSeverityMetric(statistics)
+        super(AnalysisResultMetric, self).__init__(statistics.count, children=[max_severity, avg_severity])
 
 
 class AnalysisReport(report.Report):
@@ -73,3 +113,83 @@ class AnalysisReport(report.Report):
 
     def get_conflicts(self) -> typing.Iterable[analysis.AnalysisResult]:
         return sorted(itertools.chain(*self.results_by_type.values()), key=lambda r: -r.severity)
+
+
+class StreamingAnalysisReport(report.Report):
+    """
+    Report for analysis results that are reported as soon as they are found. Only the statistics of the results are
+    kept, so the metrics are available once all results have been added while the results themselves are not.
+    """
+    has_metrics = True
+
+    def __init__(self, fail_on: typing.Optional[float] = None):
+        """
+        :param fail_on: The severity from which a result fails the report.
+        """
+        self.fail_on = fail_on
+        self.failed = False
+        self.statistics_by_type: typing.Dict[typing.Type[analysis.AnalysisResult], SeverityStatistics] = {}
+
+    def add(self, result: analysis.AnalysisResult) -> bool:
+        """
+        Adds an analysis result to the statistics.
+
+        :param result: The result to add.
+        :return: Whether the result fails the report.
+        """
+        statistics = self.statistics_by_type.get(result.__class__)
+        if statistics is None:
+            statistics = self.statistics_by_type[result.__class__] = SeverityStatistics()
+        statistics.add(result)
+
+        failed = self.fail_on is not None and result.severity >= self.fail_on
+        self.failed = self.failed or failed
+        return failed
+
+    def get_metrics(self) -> typing.Iterable[report.Metric]:
+        for cls, statistics in sorted(self.statistics_by_type.items(), key=lambda i: i[0].name):
+            yield AnalysisResultMetric(cls, statistics)
+
+
+def _node_key(node: ir.Node) -> typing.Tuple:
+    return node.location.as_tuple() if node.location is not None else ()
+
+
+def _node_as_dict(node: ir.Node) -> typing.Dict[str, typing.Any]:
+    location = node.source_range
+    return {
+        'type': node.type,
+        'label': node.label,
+        'range': [list(location.start.as_tuple()), list(location.end.coordinates)] if location is not None else None,
+    }
+
+
+def result_as_dict(result: analysis.AnalysisResult) -> typing.Dict[str, typing.Any]:
+    """
+    Returns a representation of an analysis result that can be encoded as JSON. Changes are ordered by location and
+    nodes are described by their type, label and source range.
+
+    :param result: The analysis result.
+    :return: The representation of the result.
+    """
+    return {
+        'key': result.key,
+        'name': result.name,
+        'analysis': result.analysis.key,
+        'severity': result.severity,
+        'changes': [{
+            'op': str(change.op),
+            'base': _node_as_dict(change.base) if change.base is not None else None,
+            'other': _node_as_dict(change.other) if change.other is not None else None,
+        } for change in sorted(result.changes, key=lambda c: _node_key(c.base or c.other))],
+        'base_nodes': [_node_as_dict(node) for node in sorted(result.base_nodes, key=_node_key)],
+        'other_nodes': [_node_as_dict(node) for node in sorted(result.other_nodes, key=_node_key)],
+    }
+
+
+def metric_as_dict(metric: report.Metric) -> typing.Dict[str, typing.Any]:
+    """
+    :param metric: The metric.
+    :return: A representation of the metric and its children that can be encoded as JSON.
+    """
+    return {'name': metric.name, 'value': metric.value, 'children': [metric_as_dict(c) for c in metric.children]}
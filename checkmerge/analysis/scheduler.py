@@ -0,0 +1,184 @@
+import typing
+from concurrent.futures import Executor, Future, ProcessPoolExecutor, ThreadPoolExecutor
+
+import bidict
+
+from checkmerge import diff, ir
+from checkmerge.analysis import Analysis, AnalysisContext, AnalysisResult, AnalysisResultGenerator
+from checkmerge.ir import serialize
+from checkmerge.util.trace import tracer
+
+
+# Type definitions
+AnalysisChain = typing.List[typing.Tuple[Analysis, typing.Tuple]]
+NodeKey = typing.Tuple[int, int]
+EncodedChange = typing.Tuple[typing.Optional[NodeKey], typing.Optional[NodeKey], diff.EditOperation]
+EncodedResult = typing.Tuple[typing.Type[AnalysisResult], typing.List[EncodedChange], typing.List[NodeKey],
+                             typing.List[NodeKey]]
+IndexPairs = typing.Tuple[typing.List[int], typing.List[int]]
+
+
+class AnalysisScheduler(object):
+    """
+    Runs the analyses of a run configuration, one after another or concurrently, and merges their results into a single
+    stream in the order of the analyses.
+
+    Analyses of the same diff result share an analysis context (see `AnalysisContext`). In the `threads` mode the
+    analyses run in a thread pool and share the context as well, which pays off for analyses spending their time in
+    native code. In the `processes` mode every analysis runs in a worker process on a copy of the trees and the diff
+    result, which are exchanged in serialized form (see `ir.serialize`), and the results are translated back to the
+    nodes and changes of this process. Each worker builds the views of its analysis itself.
+    """
+    modes = ('threads', 'processes')
+
+    def __init__(self, mode: typing.Optional[str] = None, workers: typing.Optional[int] = None):
+        """
+        :param mode: How to run the analyses concurrently, `threads`, `processes` or `None` to run them one after
+                     another.
+        :param workers: The maximum number of threads or worker processes, defaults to the number of analyses.
+        """
+        if mode is not None and mode not in self.modes:
+            raise ValueError(f"Unknown analysis mode '{mode}'.")
+        self.mode = mode
+        self.workers = workers
+
+    def run(self, chain: AnalysisChain) -> AnalysisResultGenerator:
+        """
+        Runs the given analyses. While tracing, or when running concurrently, each analysis runs to completion before
+        its results are yielded.
+
+        :param chain: The analyses with the arguments to call them with.
+        :return: A generator yielding the results of the analyses.
+        """
+        contexts: typing.Dict[int, AnalysisContext] = {}
+
+        def context(changes: diff.DiffResult) -> AnalysisContext:
+            if id(changes) not in contexts:
+                contexts[id(changes)] = AnalysisContext(changes)
+            return contexts[id(changes)]
+
+        if self.mode is None or len(chain) < 2:
+            for func, (changes, *args) in chain:
+                if tracer.enabled:
+                    results = _run(func, changes, context(changes), *args)
+                    yield from results
+                else:
+                    yield from func(changes, *args, context=context(changes))
+            return
+
+        with self._executor(len(chain)) as executor:
+            if self.mode == 'threads':
+                futures = [executor.submit(_run, func, changes, context(changes), *args)
+                           for func, (changes, *args) in chain]
+                for future in futures:
+                    yield from future.result()
+            else:
+                yield from self._run_processes(executor, chain)
+
+    def _executor(self, n: int) -> Executor:
+        workers = self.workers or n
+        return ThreadPoolExecutor(max_workers=workers) if self.mode == 'threads' else ProcessPoolExecutor(workers)
+
+    @staticmethod
+    def _run_processes(executor: Executor, chain: AnalysisChain) -> AnalysisResultGenerator:
+        """Runs the analyses in worker processes, sending the trees and mappings of each diff result once."""
+        payloads: typing.Dict[int, typing.Tuple[bytes, typing.List[IndexPairs]]] = {}
+        futures: typing.List[typing.Tuple[Analysis, diff.DiffResult, Future]] = []
+
+        for func, (changes, *args) in chain:
+            if id(changes) not in payloads:
+                payloads[id(changes)] = _encode_diff(changes)
+            blob, mappings = payloads[id(changes)]
+            futures.append((func, changes, executor.submit(_analysis_worker, func, blob, mappings, *args)))
+
+        for func, changes, future in futures:
+            yield from _decode_results(func, changes, future.result())
+
+
+def _run(func: Analysis, changes: diff.DiffResult, context: AnalysisContext, *args: typing.Any) \
+        -> typing.List[AnalysisResult]:
+    """Runs an analysis to completion within its span."""
+    with tracer.span('analysis', analysis=func.key):
+        return list(func(changes, *args, context=context))
+
+
+def _trees(changes: diff.DiffResult) -> typing.Tuple[ir.Node, ...]:
+    """The trees of a diff result in the order in which they are exchanged with the workers."""
+    return AnalysisContext(changes).trees
+
+
+def _index_pairs(root1: ir.Node, root2: ir.Node, mapping: diff.DiffMapping) -> IndexPairs:
+    """The indices of the mapped nodes of two trees in top-down walks of the trees."""
+    return [n.index - root1.index for n in mapping.keys()], [n.index - root2.index for n in mapping.values()]
+
+
+def _encode_diff(changes: diff.DiffResult) -> typing.Tuple[bytes, typing.List[IndexPairs]]:
+    """Serializes the trees of a diff result with the mappings between them as indices."""
+    trees = _trees(changes)
+    mappings = [_index_pairs(changes.base, changes.other, changes.mapping)]
+    if isinstance(changes, diff.MergeDiffResult):
+        mappings += [_index_pairs(changes.ancestor, changes.base, changes.base_mapping),
+                     _index_pairs(changes.ancestor, changes.other, changes.other_mapping)]
+    return serialize.dumps(trees), mappings
+
+
+def _decode_diff(blob: bytes, mappings: typing.List[IndexPairs]) -> diff.DiffResult:
+    """Restores a diff result serialized with `_encode_diff()` and tags its nodes."""
+    trees = serialize.loads(blob)
+
+    def mapping(root1: ir.Node, root2: ir.Node, index_pairs: IndexPairs) -> diff.DiffMapping:
+        return bidict.bidict((root1.flat.nodes[i], root2.flat.nodes[j]) for i, j in zip(*index_pairs))
+
+    if len(trees) == 3:
+        ancestor, base, other = trees
+        base_result = diff.DiffResult(ancestor, base, mapping(ancestor, base, mappings[1]))
+        other_result = diff.DiffResult(ancestor, other, mapping(ancestor, other, mappings[2]))
+        # The two-way result completes the combined mapping to the mapping of the original result
+        two_way_result = diff.DiffResult(base, other, mapping(base, other, mappings[0]))
+        changes = diff.MergeDiffResult(base, other, ancestor, base_result, other_result, two_way_result)
+    else:
+        base, other = trees
+        changes = diff.DiffResult(base, other, mapping(base, other, mappings[0]))
+
+    diff.tag_nodes(changes)
+    return changes
+
+
+def _analysis_worker(func: Analysis, blob: bytes, mappings: typing.List[IndexPairs], *args: typing.Any) \
+        -> typing.List[EncodedResult]:
+    """
+    Worker process function running an analysis on a serialized diff result. The nodes in the results are returned as
+    the position of their tree and their index in a top-down walk of the tree.
+    """
+    changes = _decode_diff(blob, mappings)
+    trees = {root.flat: k for k, root in enumerate(_trees(changes))}
+
+    def key(node: typing.Optional[ir.Node]) -> typing.Optional[NodeKey]:
+        return None if node is None else (trees[node.flat], node.index)
+
+    return [(type(result), [(key(c.base), key(c.other), c.op) for c in result.changes],
+             [key(n) for n in result.base_nodes], [key(n) for n in result.other_nodes])
+            for result in func(changes, *args)]
+
+
+def _decode_results(func: Analysis, changes: diff.DiffResult, results: typing.List[EncodedResult]) \
+        -> AnalysisResultGenerator:
+    """Translates the results of a worker process to the nodes and changes of the given diff result."""
+    trees = _trees(changes)
+
+    def node(k: typing.Optional[NodeKey]) -> typing.Optional[ir.Node]:
+        return None if k is None else trees[k[0]].flat.nodes[trees[k[0]].index + k[1]]
+
+    # Results refer to the changes of the diff result where possible, as changes are compared by identity
+    known: typing.Dict[typing.Tuple, diff.Change] = {c.as_tuple(): c for c in changes.changes}
+    if isinstance(changes, diff.MergeDiffResult):
+        for c in (*changes.base_changes, *changes.other_changes):
+            known.setdefault(c.as_tuple(), c)
+
+    def change(base: typing.Optional[NodeKey], other: typing.Optional[NodeKey], op: diff.EditOperation) -> diff.Change:
+        key = (node(base), node(other), op)
+        return known.get(key) or diff.Change(*key)
+
+    for cls, result_changes, base_nodes, other_nodes in results:
+        yield cls(changes=[change(*c) for c in result_changes], analysis=func,
+                  base_nodes=[node(k) for k in base_nodes], other_nodes=[node(k) for k in other_nodes])
@@ -0,0 +1,41 @@
+import unittest
+
+from checkmerge.analysis import optimize_change_sets
+from checkmerge.ir import Node
+
+
+class OptimizeChangeSetsTestCase(unittest.TestCase):
+    def setUp(self):
+        self.tree = Node(typ="FunctionDef", label="calc", children=[
+            Node(typ="FunctionParam", label="a"),
+            Node(typ="BasicBlock", children=[
+                Node(typ="VariableDef", label="c", children=[
+                    Node(typ="VariableRef", label="a"),
+                ]),
+                Node(typ="Return", children=[
+                    Node(typ="VariableRef", label="c"),
+                ]),
+            ]),
+        ])
+        self.other = Node(typ="FunctionDef", label="calc", children=[
+            Node(typ="Return"),
+        ])
+
+    def test_replace_descendants(self):
+        """Tests that descendants are replaced by the outermost ancestor from another set."""
+        result = list(optimize_change_sets([
+            {self.tree[1, 0, 0], self.other[0]},
+            {self.tree[1, 0], self.tree[0]},
+            {self.tree[1], self.other},
+        ]))
+
+        self.assertCountEqual([{self.tree[1], self.other}, {self.tree[1], self.tree[0]}], result)
+
+    def test_same_set(self):
+        """Tests that descendants of nodes in the same set only are kept."""
+        result = list(optimize_change_sets([
+            {self.tree[1], self.tree[1, 1, 0]},
+            {self.tree[0], self.other[0]},
+        ]))
+
+        self.assertCountEqual([{self.tree[1], self.tree[1, 1, 0]}, {self.tree[0], self.other[0]}], result)
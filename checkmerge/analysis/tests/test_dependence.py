@@ -1,7 +1,7 @@
 import unittest
 
 from checkmerge import app
-from checkmerge.analysis.dependence import DependenceAnalysis
+from checkmerge.analysis.dependence import DependenceAnalysis, MemoryDependenceClosure
 from checkmerge.ir import Node, Dependency, DependencyType
 
 
@@ -115,3 +115,11 @@ class DependenceAnalysisTestCase(unittest.TestCase):
             changes.changes_by_node[self.branch1[2, 2]],
             changes.changes_by_node[self.branch2[2, 2]],
         }, change_set)
+
+    def test_closure(self):
+        """Tests that the precomputed closures equal the dependencies collected by the reference implementation."""
+        for root in (self.ancestor, self.branch1, self.branch2):
+            closure = MemoryDependenceClosure(root, DependenceAnalysis.is_memory_dependency)
+            for node in root.subtree():
+                self.assertEqual(set(DependenceAnalysis.get_dependencies(node)),
+                                 set(closure.nodes(closure.dependencies(node))))
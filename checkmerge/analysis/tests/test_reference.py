@@ -0,0 +1,43 @@
+import unittest
+
+from checkmerge import app
+from checkmerge.analysis.reference import ReferenceAnalysis, RenamedReferenceConflict
+from checkmerge.ir import Node, Dependency, DependencyType
+
+
+class ReferenceAnalysisTestCase(unittest.TestCase):
+    def setUp(self):
+        def program(name: str, uses: int) -> Node:
+            root = Node(typ="TranslationUnit", children=[
+                Node(typ="FunctionDef", label=name, ref="c:@F@f"),
+                Node(typ="FunctionDef", label="main", ref="c:@F@main", children=[
+                    Node(typ="BasicBlock", children=[
+                        Node(typ="FunctionCall", label=f"call{i}", children=[
+                            Node(typ="DeclRefExpr", label="f"),
+                        ]) for i in range(uses)
+                    ]),
+                ]),
+            ])
+            for i in range(uses):
+                root[1, 0, i, 0].add_dependencies(Dependency(root[0], DependencyType.REFERENCE))
+            return root
+
+        self.ancestor = program("f", 1)
+        self.base = program("g", 1)
+        self.other = program("f", 2)
+
+    def test_renamed_reference(self):
+        """Tests that a new use of a renamed definition is reported."""
+        config = app.CheckMerge().build_config().diff(self.base, self.other, self.ancestor).analyze(ReferenceAnalysis)
+        analysis = list(config.analysis())
+
+        self.assertEqual(1, len(analysis))
+        self.assertIsInstance(analysis[0], RenamedReferenceConflict)
+        self.assertIn(self.other[1, 0, 1, 0], {c.other for c in analysis[0].changes})
+
+    def test_use_set(self):
+        """Tests that the uses from the reference index equal the uses from the dependencies."""
+        for root in (self.ancestor, self.base, self.other):
+            for node in root.subtree():
+                self.assertEqual(set(ReferenceAnalysis.get_uses(node)), ReferenceAnalysis.get_use_set(node))
+            self.assertEqual([root[0]], [root.flat.nodes[i] for i in root.flat.references.definitions])
@@ -0,0 +1,47 @@
+import json
+import unittest
+
+from checkmerge import diff, ir
+from checkmerge.analysis.dependence import DependenceAnalysis, MemoryDependenceConflict
+from checkmerge.analysis.reference import DeletedReferenceConflict, ReferenceAnalysis
+from checkmerge.analysis.report import AnalysisReport, StreamingAnalysisReport, result_as_dict
+
+
+class StreamingAnalysisReportTestCase(unittest.TestCase):
+    def setUp(self):
+        location = ir.Location('a.c', 1, 1)
+        self.base = ir.Node('VariableRef', label='a', source_range=ir.Range(location, ir.Location('a.c', 1, 2)))
+        self.other = ir.Node('VariableRef', label='b')
+        change = diff.Change(self.base, self.other, diff.EditOperation.RENAME)
+
+        self.results = [
+            MemoryDependenceConflict([change], DependenceAnalysis()),
+            DeletedReferenceConflict([change], ReferenceAnalysis(), other_nodes=[self.other]),
+            MemoryDependenceConflict([], DependenceAnalysis()),
+        ]
+
+    def test_metrics(self):
+        """Tests that the incremental metrics are equal to the metrics of the full report."""
+        stream = StreamingAnalysisReport()
+        for result in self.results:
+            self.assertFalse(stream.add(result))
+
+        def flatten(metrics):
+            return [(m.as_tuple(), [c.as_tuple() for c in m.children]) for m in metrics]
+
+        self.assertEqual(flatten(AnalysisReport(self.results).get_metrics()), flatten(stream.get_metrics()))
+        self.assertFalse(stream.failed)
+
+    def test_fail_on(self):
+        """Tests that results from the severity threshold fail the report."""
+        stream = StreamingAnalysisReport(fail_on=DeletedReferenceConflict.severity)
+        self.assertEqual([False, True, False], [stream.add(result) for result in self.results])
+        self.assertTrue(stream.failed)
+
+    def test_result_as_dict(self):
+        """Tests the JSON representation of results."""
+        data = json.loads(json.dumps(result_as_dict(self.results[1])))
+        self.assertEqual(DeletedReferenceConflict.key, data['key'])
+        self.assertEqual('~', data['changes'][0]['op'])
+        self.assertEqual([['a.c', 1, 1], [1, 2]], data['changes'][0]['base']['range'])
+        self.assertEqual({'type': 'VariableRef', 'label': 'b', 'range': None}, data['other_nodes'][0])
@@ -0,0 +1,51 @@
+import unittest
+
+from checkmerge import app
+from checkmerge.analysis import AnalysisContext
+from checkmerge.analysis.dependence import DependenceAnalysis
+from checkmerge.analysis.reference import ReferenceAnalysis
+from checkmerge.analysis.scheduler import AnalysisScheduler
+from checkmerge.analysis.tests import test_dependence, test_reference
+
+
+class AnalysisSchedulerTestCase(unittest.TestCase):
+    def setUp(self):
+        dependence = test_dependence.DependenceAnalysisTestCase()
+        dependence.setUp()
+        reference = test_reference.ReferenceAnalysisTestCase()
+        reference.setUp()
+
+        config = app.CheckMerge().build_config()
+        two_way = config.diff(dependence.branch1, dependence.branch2)
+        merge = config.diff(reference.base, reference.other, reference.ancestor)
+        self.chain = two_way.analyze(DependenceAnalysis)._analysis_chain + \
+            merge.analyze(ReferenceAnalysis).analyze(DependenceAnalysis)._analysis_chain
+
+    def run_chain(self, mode):
+        return [(type(result), {c.as_tuple() for c in result.changes}, result.base_nodes, result.other_nodes)
+                for result in AnalysisScheduler(mode).run(self.chain)]
+
+    def test_modes(self):
+        """Tests that running the analyses concurrently yields the same results in the same order."""
+        expected = self.run_chain(None)
+        self.assertEqual(2, len(expected))
+        self.assertEqual(expected, self.run_chain('threads'))
+        self.assertEqual(expected, self.run_chain('processes'))
+
+    def test_changes(self):
+        """Tests that results from worker processes refer to the changes of the diff result."""
+        changes = {id(c) for func, (result, ) in self.chain for c in result.changes}
+        for result in AnalysisScheduler('processes').run(self.chain):
+            self.assertTrue(all(id(c) in changes for c in result.changes))
+
+    def test_context(self):
+        """Tests that views are computed once per context."""
+        _, (changes, ) = self.chain[0]
+        context = AnalysisContext(changes)
+        calls = []
+        for _ in range(2):
+            context.view('test', lambda: calls.append(1))
+        self.assertEqual(1, len(calls))
+        self.assertEqual(2, len(context.trees))
+        self.assertEqual([n for n in changes.base.subtree() if n.is_memory_operation],
+                         context.memory_operations(changes.base))
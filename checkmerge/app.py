@@ -1,17 +1,27 @@
 import sys
 import typing
+from concurrent.futures import ProcessPoolExecutor, as_completed
 from contextlib import contextmanager
 from copy import copy
 
+import bidict
 import datetime
 
 from checkmerge import analysis as _analysis, diff as _diff, ir, parse, plugins, version
+from checkmerge.analysis.scheduler import AnalysisScheduler
 from checkmerge.diff import gumtree
+from checkmerge.ir import serialize
+from checkmerge.parse.cache import ParseCache
+from checkmerge.util.trace import tracer
 
 
 # Type variables
 T = typing.TypeVar('T')
 
+# Type definitions
+BatchJob = typing.Tuple[str, str, typing.Optional[str]]
+BatchReport = typing.Callable[["RunConfig", typing.List[_analysis.AnalysisResult]], T]
+
 
 def format_version(*args: typing.Union[int, str]) -> str:
     """
@@ -72,6 +82,11 @@ class CheckMergeMeta(type):
         """The loaded analysis."""
         return plugins.registry.analysis.all()
 
+    @property
+    def diff_algorithms(cls) -> typing.Iterable[typing.Type[_diff.DiffAlgorithm]]:
+        """The loaded diff algorithms."""
+        return plugins.registry.diff.all()
+
     @property
     def repo(cls) -> str:
         """The URL to the main repository."""
@@ -113,6 +128,7 @@ class CheckMerge(object, metaclass=CheckMergeMeta):
 
     def __init__(self):
         self._parser: typing.Optional[typing.Type[parse.Parser]] = None
+        self._diff_algorithm: typing.Optional[typing.Type[_diff.DiffAlgorithm]] = None
         self._options: typing.Dict[str, typing.Any] = {}
         self._timers: typing.Dict[str, typing.Tuple[datetime.datetime, typing.Optional[datetime.datetime]]] = {}
 
@@ -131,7 +147,16 @@ class CheckMerge(object, metaclass=CheckMergeMeta):
 
     @property
     def diff_algorithm(self) -> typing.Optional[typing.Type[_diff.DiffAlgorithm]]:
-        return gumtree.GumTreeDiff
+        return self._diff_algorithm or gumtree.GumTreeDiff
+
+    @diff_algorithm.setter
+    def diff_algorithm(self, value: str):
+        diff_algorithm = plugins.registry.diff.find(value)
+
+        if diff_algorithm is None:
+            raise ValueError(f"No diff algorithm with name '{value}' has been found.")
+
+        self._diff_algorithm = diff_algorithm
 
     @property
     def options(self) -> typing.Dict[str, typing.Any]:
@@ -189,16 +214,73 @@ class CheckMerge(object, metaclass=CheckMergeMeta):
 
     @contextmanager
     def time(self, key: str):
-        """Generator starting and stopping a timer with the given key to be used in a `with` statement."""
+        """
+        Generator starting and stopping a timer with the given key to be used in a `with` statement. The timed work is
+        traced as a span as well.
+        """
         self.start_timer(key)
-        yield
+        with tracer.span(key):
+            yield
         self.stop_timer(key)
 
+    def batch(self, jobs: typing.Iterable[BatchJob], analysis: typing.Iterable[typing.Type[_analysis.Analysis]],
+              report: BatchReport, workers: typing.Optional[int] = None) \
+            -> typing.Generator["BatchResult", None, None]:
+        """
+        Analyzes many triples of programs in a pool of worker processes, yielding the result of each job as soon as it
+        finishes. Every worker sets up CheckMerge and constructs the parser once, and shares it between its jobs.
+
+        The analysis results refer to the trees of the worker, so the report function is called in the worker to turn
+        them into a value that can be returned, such as formatted text. It must be a module level function.
+
+        :param jobs: The paths of the base, other and (optional) ancestor programs of each job.
+        :param analysis: The analysis to perform for each job.
+        :param report: Function building the value to return for a job from its configuration and analysis results.
+        :param workers: The number of worker processes, defaults to the number of processors.
+        :return: A generator yielding the results of the jobs in order of completion.
+        """
+        # Worker processes run their jobs sequentially, the pool already keeps all processors busy
+        options = dict(self.options, parallel=False)
+        initargs = (self.parser, self.diff_algorithm, options, list(analysis), report)
+
+        with ProcessPoolExecutor(max_workers=workers, initializer=_batch_init, initargs=initargs) as executor:
+            futures = [executor.submit(_batch_worker, tuple(job)) for job in jobs]
+            for future in as_completed(futures):
+                yield future.result()
+
+
+class BatchResult(typing.NamedTuple):
+    """
+    The result of a job of a batch run (see `CheckMerge.batch()`).
+    """
+    #: The paths of the programs of the job.
+    job: BatchJob
+    #: The value returned by the report function, or `None` if the job failed.
+    report: typing.Any
+    #: The number of analysis results.
+    count: int
+    #: The error message if the job failed.
+    error: typing.Optional[str] = None
+
 
 class RunConfig(object):
     """
     A run configuration. When configured using the correct classes this object can be used to declaratively define the
     analysis that should be carried out.
+
+    The following options are supported:
+      - `cache`: Whether to use the persistent cache of parsed trees (see `ParseCache`). Disabled by default.
+      - `cache_dir`: The directory of the cache, defaults to `ParseCache.default_directory()`.
+      - `parser_options`: Keyword arguments for constructing the parser. A single parser is used for all versions.
+      - `diff_options`: Keyword arguments for constructing the diff algorithm, such as the `time_budget` and
+        `work_budget` of `GumTreeDiff`.
+      - `parallel`: Whether to parse the versions and diff them against their ancestor in separate worker processes.
+        Trees are exchanged with the workers in serialized form (see `ir.serialize`). Disabled by default.
+      - `diff_cache`: A mutable mapping in which the results of sequential diffs are kept by the diff algorithm, the
+        diffed trees and the diff options, so trees that are diffed again are not. Used by long-running processes
+        keeping trees resident (see `daemon.Daemon`).
+      - `parallel_analysis`: Whether to run the scheduled analyses concurrently in `threads` or in worker `processes`
+        (see `AnalysisScheduler`). Disabled by default.
     """
 
     def __init__(self, parse_cls: typing.Type[parse.Parser], diff_cls: typing.Type[_diff.DiffAlgorithm], **options):
@@ -215,28 +297,75 @@ class RunConfig(object):
         self._other_tree: ir.Node = None
         self._ancestor_tree: ir.Node = None
         self._diff_result: _diff.DiffResult = None
+        self._parser_instance: typing.Optional[parse.Parser] = None
         self._analysis_chain: typing.List[typing.Tuple[_analysis.Analysis, typing.Tuple]] = []
 
-    def parse(self, base_path: str, other_path: str, ancestor_path: typing.Optional[str] = None) -> "RunConfig":
+    @property
+    def parser_options(self) -> typing.Dict[str, typing.Any]:
+        """The keyword arguments for constructing the parser."""
+        return self.options.get('parser_options') or {}
+
+    @property
+    def diff_options(self) -> typing.Dict[str, typing.Any]:
+        """The keyword arguments for constructing the diff algorithm."""
+        return self.options.get('diff_options') or {}
+
+    @property
+    def parser_instance(self) -> parse.Parser:
+        """
+        The parser instance of this configuration, which is shared with the configurations derived from it. Parsers can
+        therefore keep state, such as compiled headers, between parses.
+        """
+        if self._parser_instance is None:
+            self._parser_instance = self.parser(**self.parser_options)
+        return self._parser_instance
+
+    def parse_tree(self, path: typing.Union[str, parse.Source]) -> ir.Node:
         """
-        Parses two programs into internal representation trees.
+        Parses a single program into an internal representation tree, using the cache of parsed programs if enabled.
+        The parsed tree is not stored in this configuration.
+
+        :param path: The path of the program, or a source held in memory.
+        :return: The tree of the program.
+        """
+        cache_dir = self.options.get('cache_dir') if self.options.get('cache', False) else False
+        with tracer.span('parse', file=getattr(path, 'path', path)):
+            return _parse(self.parser_instance, path, cache_dir)[0]
+
+    def parse(self, base_path: typing.Union[str, parse.Source], other_path: typing.Union[str, parse.Source],
+              ancestor_path: typing.Union[str, parse.Source, None] = None) -> "RunConfig":
+        """
+        Parses two programs into internal representation trees. Programs are given by their path, or as sources held
+        in memory (see `parse.Source`).
 
         :param base_path: The path to the base program to parse.
         :param other_path: The path to the other program to parse.
         :param ancestor_path: (Optional) The path to the ancestor of both programs to parse.
         """
+        # Construct the parser before copying so it is shared with this instance
+        _ = self.parser_instance
+
         # Copy instance
         rc = copy(self)
 
-        # Construct parser
-        parser = rc.parser()
+        # Options for parsing
+        cache_dir = rc.options.get('cache_dir') if rc.options.get('cache', False) else False
 
         # Parse trees
         with rc._arg(base_path, '_base_path') as base_path, rc._arg(other_path, '_other_path') as other_path,\
                 rc._arg(ancestor_path, '_ancestor_path') as ancestor_path:
-            base_tree = parser.parse_file(base_path)[0]
-            other_tree = parser.parse_file(other_path)[0]
-            ancestor_tree = parser.parse_file(ancestor_path)[0] if ancestor_path is not None else None
+            paths = [p for p in (base_path, other_path, ancestor_path) if p is not None]
+
+            if rc.options.get('parallel', False):
+                n = len(paths)
+                with ProcessPoolExecutor(max_workers=n) as executor:
+                    blobs = list(executor.map(_parse_worker, [rc.parser] * n, [rc.parser_options] * n, paths,
+                                              [cache_dir] * n))
+                trees = [serialize.loads(blob)[0] for blob in blobs]
+            else:
+                trees = [rc.parse_tree(path) for path in paths]
+
+            base_tree, other_tree, ancestor_tree = (trees + [None])[:3]
 
         # Store results
         rc._base_tree, rc._other_tree, rc._ancestor_tree = base_tree, other_tree, ancestor_tree
@@ -246,7 +375,8 @@ class RunConfig(object):
     def diff(self, base: typing.Optional[ir.Node] = None, other: typing.Optional[ir.Node] = None,
              ancestor: typing.Optional[ir.Node] = None) -> "RunConfig":
         """
-        Calculates the difference between two internal representation trees.
+        Calculates the difference between two internal representation trees. Unless the versions are diffed in
+        parallel or through the diff cache, the versions of a merge are diffed at once (see `DiffAlgorithm.merge()`).
 
         :param base: The base tree.
         :param other: The other tree.
@@ -258,22 +388,28 @@ class RunConfig(object):
         # Diff trees
         with rc._arg(base, '_base_tree') as base, rc._arg(other, '_other_tree') as other,\
                 rc._arg(ancestor, '_ancestor_tree') as ancestor:
-            if ancestor is not None:
+            if ancestor is not None and not rc.options.get('parallel', False) and rc.options.get('diff_cache') is None:
+                # Diff the merge at once, so the diff algorithm can share work between the diffs
+                result = rc.differ(**rc.diff_options).merge(ancestor, base, other)
+            elif ancestor is not None:
                 # Diff each version since the common ancestor
-                base_result = rc.differ()(ancestor, base)
-                other_result = rc.differ()(ancestor, other)
+                if rc.options.get('parallel', False):
+                    base_result, other_result = rc._parallel_diff(ancestor, base, other)
+                else:
+                    base_result = rc._run_diff('ancestor/base', ancestor, base)
+                    other_result = rc._run_diff('ancestor/other', ancestor, other)
 
                 # Merge results to get the matching nodes between the two versions
                 mapping = _diff.combine_mappings(base_result.mapping, other_result.mapping)
 
                 # Try to remove matching changes by diffing the two versions, assuming the mappings from the ancestor
-                two_way_result = rc.differ()(base, other, mapping)
+                two_way_result = rc._run_diff('base/other', base, other, mapping, ancestor)
 
                 # Build a combined result
                 result = _diff.MergeDiffResult(base, other, ancestor, base_result, other_result, two_way_result)
             else:
                 # Diff the two versions
-                result = rc.differ()(base, other)
+                result = rc._run_diff('base/other', base, other)
 
         # Tag nodes with changes
         _diff.tag_nodes(result)
@@ -299,7 +435,7 @@ class RunConfig(object):
 
         # Store analysis generator
         with rc._arg(changes, '_diff_result') as changes:
-            rc._analysis_chain.append((analysis, (changes,)))
+            rc._analysis_chain = rc._analysis_chain + [(analysis, (changes,))]
 
         return rc
 
@@ -321,10 +457,59 @@ class RunConfig(object):
 
     def analysis(self) -> _analysis.AnalysisResultGenerator:
         """
-        Returns a generator yielding the analysis results.
+        Returns a generator yielding the analysis results in the order of the scheduled analyses. The analyses share
+        an analysis context per diff result. While tracing, each analysis runs to completion within its span before
+        its results are yielded.
+        """
+        scheduler = AnalysisScheduler(self.options.get('parallel_analysis'))
+        yield from scheduler.run(self._analysis_chain)
+
+    def _run_diff(self, versions: str, base: ir.Node, other: ir.Node,
+                  mapping: typing.Optional[_diff.DiffMapping] = None,
+                  ancestor: typing.Optional[ir.Node] = None) -> _diff.DiffResult:
         """
-        for func, args in self._analysis_chain:
-            yield from func(*args)
+        Diffs two trees, or returns the result of an earlier diff of the same trees from the diff cache.
+
+        :param versions: The description of the diffed versions for tracing.
+        :param base: The base tree.
+        :param other: The other tree.
+        :param mapping: The mapping to start off with, which is derived from the diffs against the ancestor.
+        :param ancestor: The ancestor the mapping is derived from.
+        :return: The diff result.
+        """
+        cache = self.options.get('diff_cache')
+        key = (self.differ, base, other, ancestor, *sorted(self.diff_options.items()))
+
+        if cache is not None and key in cache:
+            tracer.count('diff.cached')
+            return cache[key]
+
+        with tracer.span('diff', versions=versions):
+            result = self.differ(**self.diff_options)(base, other, mapping)
+
+        if cache is not None:
+            cache[key] = result
+        return result
+
+    def _parallel_diff(self, ancestor: ir.Node, *versions: ir.Node) -> typing.List[_diff.DiffResult]:
+        """
+        Diffs each of the given versions against the ancestor in a separate worker process.
+
+        :param ancestor: The common ancestor tree.
+        :param versions: The versions to diff.
+        :return: The diff results for the versions.
+        """
+        ancestor_blob = serialize.dumps([ancestor])
+        blobs = [serialize.dumps([v]) for v in versions]
+
+        n = len(versions)
+        with ProcessPoolExecutor(max_workers=n) as executor:
+            results = list(executor.map(_diff_worker, [self.differ] * n, [self.diff_options] * n,
+                                        [ancestor_blob] * n, blobs))
+
+        return [_diff.DiffResult(ancestor, version, bidict.bidict(
+            (_node_at(ancestor, i), _node_at(version, j)) for i, j in zip(base_indices, other_indices)
+        ), truncated=truncated) for version, (base_indices, other_indices, truncated) in zip(versions, results)]
 
     @contextmanager
     def _arg(self, value: T, key: str) -> T:
@@ -339,3 +524,75 @@ class RunConfig(object):
         yield values
         for k, v in zip((k for v, k in args), values):
             setattr(self, k, v)
+
+
+def _parse(parser: parse.Parser, path: typing.Union[str, parse.Source], cache_dir: typing.Union[str, None, bool]) \
+        -> typing.List[ir.Node]:
+    """
+    Parses a file or a source held in memory, using the parse cache in the given directory unless the cache directory is
+    `False`.
+    """
+    if cache_dir is False:
+        return parser.parse_buffer(path) if isinstance(path, parse.Source) else parser.parse_file(path)
+    return ParseCache(cache_dir).parse_file(parser, path)
+
+
+def _parse_worker(parser_cls: typing.Type[parse.Parser], parser_options: typing.Dict[str, typing.Any],
+                  path: typing.Union[str, parse.Source], cache_dir: typing.Union[str, None, bool]) -> bytes:
+    """Worker process function for parsing a file, which returns the trees in serialized form."""
+    return serialize.dumps(_parse(parser_cls(**parser_options), path, cache_dir))
+
+
+def _diff_worker(diff_cls: typing.Type[_diff.DiffAlgorithm], diff_options: typing.Dict[str, typing.Any],
+                 base_blob: bytes, other_blob: bytes) \
+        -> typing.Tuple[typing.List[int], typing.List[int], typing.FrozenSet[str]]:
+    """
+    Worker process function for diffing two serialized trees. The mapping is returned as the indices of the mapped
+    nodes in a top-down walk of their trees, together with the truncated phases of the diff.
+    """
+    base, other = serialize.loads(base_blob)[0], serialize.loads(other_blob)[0]
+    result = diff_cls(**diff_options)(base, other)
+    mapping = result.mapping
+    return [n.index - base.index for n in mapping.keys()], [n.index - other.index for n in mapping.values()], \
+        result.truncated
+
+
+def _node_at(root: ir.Node, index: int) -> ir.Node:
+    """Returns the node at the given index in a top-down walk of the tree of the given root."""
+    return root.flat.nodes[root.index + index]
+
+
+# The run configuration and scheduled analysis of a batch worker process, set up once per process
+_batch_state: typing.Optional[typing.Tuple["RunConfig", typing.List[typing.Type[_analysis.Analysis]], BatchReport]] \
+    = None
+
+
+def _batch_init(parser_cls: typing.Type[parse.Parser], diff_cls: typing.Type[_diff.DiffAlgorithm],
+                options: typing.Dict[str, typing.Any], analysis: typing.List[typing.Type[_analysis.Analysis]],
+                report: BatchReport) -> None:
+    """Initializer of batch worker processes, which sets up CheckMerge and the shared parser."""
+    global _batch_state
+    CheckMerge.setup()
+    config = RunConfig(parse_cls=parser_cls, diff_cls=diff_cls, **options)
+
+    # Construct the parser up front, so that loading its libraries is not part of the first job
+    _ = config.parser_instance
+    _batch_state = (config, analysis, report)
+
+
+def _batch_worker(job: BatchJob) -> BatchResult:
+    """
+    Worker process function running a single job of a batch. A failing job is reported with its error, so the other
+    jobs of the batch are not affected.
+    """
+    config, analysis, report = _batch_state
+    try:
+        config = config.parse(*(path for path in job if path is not None)).diff()
+        for analysis_cls in analysis:
+            config = config.analyze(analysis_cls)
+        results = list(config.analysis())
+        return BatchResult(job, report(config, results), len(results))
+    except parse.ParseError as e:
+        return BatchResult(job, None, 0, str(e))
+    except Exception as e:
+        return BatchResult(job, None, 0, f"{e.__class__.__name__}: {e}")
@@ -0,0 +1,144 @@
+import random
+import typing
+
+from checkmerge.ir import serialize
+from checkmerge.ir.tree import Dependency, DependencyType, Node
+
+
+class TreeGenerator(object):
+    """
+    Generator of synthetic IR trees for benchmarking.
+
+    Trees are built top-down from a small vocabulary of node types and labels. The shape of the trees is controlled by
+    the maximum depth, the share of nodes that are copies of previously generated subtrees (which exercises the hash
+    based matching of the diff algorithms) and the share of nodes with dependencies (which exercises the analysis).
+    Generation is deterministic for a seed.
+    """
+    types = ('FunctionDef', 'BasicBlock', 'VariableDef', 'VariableRef', 'BinaryOperator', 'FunctionCall', 'Return',
+             'IntegerLiteral', 'StringLiteral', 'IfStatement', 'ForStatement')
+
+    dependency_types = (DependencyType.FLOW, DependencyType.ANTI, DependencyType.OUTPUT, DependencyType.REFERENCE)
+
+    def __init__(self, seed: int = 0, depth: int = 12, repeat: float = 0.1, dependencies: float = 0.2,
+                 labels: int = 50, max_children: int = 6):
+        """
+        :param seed: The seed of the random number generator.
+        :param depth: The maximum depth of the trees.
+        :param repeat: The probability that a new subtree is a copy of a previously generated subtree.
+        :param dependencies: The expected number of dependencies per node.
+        :param labels: The number of distinct labels.
+        :param max_children: The maximum number of children generated for a node, copies excluded.
+        """
+        self.random = random.Random(seed)
+        self.depth = depth
+        self.repeat = repeat
+        self.dependencies = dependencies
+        self.labels = labels
+        self.max_children = max_children
+
+    def _node(self, parent: typing.Optional[Node] = None) -> Node:
+        return Node(self.random.choice(self.types), label=f'v{self.random.randrange(self.labels)}', parent=parent)
+
+    def tree(self, size: int) -> Node:
+        """
+        Generates a tree.
+
+        :param size: The number of nodes of the tree.
+        :return: The root of the tree.
+        """
+        root = Node('TranslationUnit')
+        nodes = [root]
+        depth = {root: 0}
+
+        # Nodes that can receive children, the most recent ones are preferred to get deeper trees
+        open_nodes = [root]
+
+        while len(nodes) < size:
+            k = len(open_nodes) - 1 - min(int(self.random.expovariate(0.5)), len(open_nodes) - 1)
+            parent = open_nodes[k]
+
+            # Copy a previously generated subtree that fits in the remaining size and depth
+            if self.repeat and len(nodes) > 1 and self.random.random() < self.repeat:
+                copied = self._copy(nodes[self.random.randrange(1, len(nodes))], parent, size - len(nodes),
+                                    self.depth - depth[parent])
+                for node, d in copied:
+                    depth[node] = depth[parent] + d
+                    nodes.append(node)
+                if copied:
+                    continue
+
+            node = self._node(parent)
+            depth[node] = depth[parent] + 1
+            nodes.append(node)
+
+            if depth[node] < self.depth:
+                open_nodes.append(node)
+            if len(parent.children) >= self.max_children:
+                del open_nodes[k]
+            if not open_nodes:
+                open_nodes.append(root)
+
+        self._add_dependencies(nodes)
+        return root
+
+    @staticmethod
+    def _copy(source: Node, parent: Node, max_size: int, max_depth: int) -> typing.List[typing.Tuple[Node, int]]:
+        """
+        Copies the structure and labels of a subtree below the given parent, unless it is larger than the given size
+        or deeper than the given depth.
+
+        :return: The copied nodes in preorder with their depth below the parent, or an empty list.
+        """
+        # Collect the subtree first, which stops as soon as it does not fit
+        originals: typing.List[typing.Tuple[Node, int, int]] = []
+        stack = [(source, -1, 1)]
+        while stack:
+            node, p, d = stack.pop()
+            if len(originals) >= max_size or d > max_depth:
+                return []
+            stack.extend((child, len(originals), d + 1) for child in reversed(node.children))
+            originals.append((node, p, d))
+
+        # The parent may be part of the subtree itself, so the copy is only attached once it is complete
+        copies: typing.List[Node] = []
+        for node, p, d in originals:
+            copies.append(Node(node.type, label=node.label, parent=copies[p] if p >= 0 else None))
+        parent.add_child(copies[0])
+        return [(copy, d) for copy, (_, _, d) in zip(copies, originals)]
+
+    def _add_dependencies(self, nodes: typing.List[Node]) -> None:
+        """Adds dependencies between random nodes of a tree, mostly to nearby nodes like in real programs."""
+        count = int(len(nodes) * self.dependencies)
+        for _ in range(count):
+            i = self.random.randrange(1, len(nodes))
+            j = max(1, min(len(nodes) - 1, i - int(self.random.expovariate(0.05))))
+            if i != j:
+                nodes[i].add_dependencies(Dependency(nodes[j], self.random.choice(self.dependency_types)))
+
+    def edit(self, root: Node, edits: int) -> Node:
+        """
+        Returns a copy of a tree with random edits: relabeled nodes, inserted leaves and deleted leaves. Dependencies
+        are copied as well.
+
+        :param root: The tree to edit.
+        :param edits: The number of edits.
+        :return: The root of the edited copy.
+        """
+        copy = serialize.loads(serialize.dumps([root]))[0]
+        nodes = list(copy.subtree())
+
+        for _ in range(edits):
+            operation = self.random.random()
+            k = self.random.randrange(1, len(nodes)) if len(nodes) > 1 else 0
+            node = nodes[k]
+
+            if operation < 0.5:
+                node.label = f'v{self.random.randrange(self.labels)}'
+            elif operation < 0.75 or k == 0 or not node.is_leaf or node.dependencies or node.reverse_dependencies:
+                nodes.append(self._node(node))
+            else:
+                node.parent.remove_child(node)
+                nodes[k] = nodes[-1]
+                nodes.pop()
+
+        return copy
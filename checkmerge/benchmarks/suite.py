@@ -0,0 +1,163 @@
+import gc
+import os
+import sys
+import time
+import typing
+
+from checkmerge import app, ir, parse
+from checkmerge.analysis.dependence import DependenceAnalysis
+from checkmerge.analysis.reference import ReferenceAnalysis
+from checkmerge.benchmarks.generate import TreeGenerator
+from checkmerge.diff import base as diff_base
+from checkmerge.diff.gumtree import GumTreeDiff
+
+
+# Type definitions
+BenchmarkResult = typing.Dict[str, typing.Any]
+
+
+class Timer(object):
+    """
+    Measures the run times of the phases of a benchmark. Every phase is run the given number of times and the fastest
+    run is kept, as slower runs are caused by other activity on the machine. Garbage collection is disabled while a
+    phase runs.
+    """
+
+    def __init__(self, runs: int = 1):
+        """
+        :param runs: The number of runs of every phase.
+        """
+        self.runs = runs
+        self.times: typing.Dict[str, float] = {}
+
+    def __call__(self, phase: str, func: typing.Callable[[], typing.Any]) -> typing.Any:
+        """
+        Runs and times a phase.
+
+        :param phase: The name of the phase.
+        :param func: The function running the phase.
+        :return: The result of the last run of the function.
+        """
+        result = None
+        best = None
+
+        for _ in range(self.runs):
+            gc.collect()
+            gc.disable()
+            try:
+                start = time.perf_counter()
+                result = func()
+                elapsed = time.perf_counter() - start
+            finally:
+                gc.enable()
+            best = elapsed if best is None else min(best, elapsed)
+
+        self.times[phase] = best
+        return result
+
+
+def benchmark_trees(ancestor: ir.Node, base: ir.Node, other: ir.Node, runs: int = 1,
+                    opt_pairs: int = 100) -> typing.Dict[str, float]:
+    """
+    Measures the phases of the diff and the analysis of a merge of the given trees.
+
+    The GumTree phases are measured on the base tree against the ancestor. The `opt()` phase is measured separately on
+    the pairs of subtrees mapped by the bottom up phase that are small enough for it. The analysis is measured on the
+    tagged result of a three-way diff.
+
+    :param ancestor: The common ancestor tree.
+    :param base: The base tree.
+    :param other: The other tree.
+    :param runs: The number of runs of every phase.
+    :param opt_pairs: The maximum number of subtree pairs to run the `opt()` phase on.
+    :return: The run time in seconds of every phase.
+    """
+    timer = Timer(runs)
+    differ = GumTreeDiff()
+
+    # Build the flat representations and hashes up front, they are shared by all phases
+    for tree in (ancestor, base, other):
+        for node in tree.subtree():
+            _ = node.hash
+
+    top_down = timer('top_down', lambda: differ.top_down(ancestor, base))
+    mapping = timer('bottom_up', lambda: differ.bottom_up(ancestor, base, top_down.copy()))
+
+    pairs = [(n1, n2) for n1, n2 in mapping.items()
+             if not n1.is_leaf and max(n1.size, n2.size) - 1 < differ.max_size][:opt_pairs]
+    timer('opt', lambda: [differ.opt(n1, n2) for n1, n2 in pairs])
+
+    timer('calculate_changes', lambda: list(diff_base.calculate_changes(ancestor, base, mapping)))
+
+    # Analysis runs on the tagged result of a three-way diff, which is computed once
+    config = app.RunConfig(None, GumTreeDiff).diff(base, other, ancestor)
+    changes = config.changes()
+    for key, analysis_cls in (('dependence_analysis', DependenceAnalysis), ('reference_analysis', ReferenceAnalysis)):
+        timer(key, lambda: list(analysis_cls()(changes)))
+
+    return timer.times
+
+
+def synthetic(size: int, seed: int = 0, edits: typing.Optional[int] = None, runs: int = 1,
+              **generator_options) -> BenchmarkResult:
+    """
+    Runs the benchmark on synthetic trees. Both versions are edited copies of a generated ancestor.
+
+    :param size: The number of nodes of the ancestor.
+    :param seed: The seed of the generator.
+    :param edits: The number of edits of each version, defaults to 1% of the size.
+    :param runs: The number of runs of every phase.
+    :param generator_options: Options of the tree generator (see `TreeGenerator`).
+    :return: The benchmark result.
+    """
+    generator = TreeGenerator(seed=seed, **generator_options)
+    edits = max(1, size // 100) if edits is None else edits
+
+    ancestor = generator.tree(size)
+    base, other = generator.edit(ancestor, edits), generator.edit(ancestor, edits)
+
+    return {
+        'input': 'synthetic',
+        'size': size,
+        'seed': seed,
+        'edits': edits,
+        'options': generator_options,
+        'nodes': [ancestor.size, base.size, other.size],
+        'phases': benchmark_trees(ancestor, base, other, runs),
+    }
+
+
+def fixtures(parser: parse.Parser, test_dir: str, runs: int = 1) -> typing.Generator[BenchmarkResult, None, None]:
+    """
+    Runs the benchmark on the test programs in the a, b and 0 directories of the test directory. Programs that cannot
+    be parsed, for example because their analysis files have not been built, are reported as skipped.
+
+    :param parser: The parser to use.
+    :param test_dir: The test directory.
+    :param runs: The number of runs of every phase.
+    :return: Generator for the benchmark results.
+    """
+    for name in sorted(os.listdir(os.path.join(test_dir, '0'))):
+        paths = [os.path.join(test_dir, version, name) for version in ('0', 'a', 'b')]
+        if not all(os.path.isfile(path) for path in paths):
+            continue
+
+        result: BenchmarkResult = {'input': 'fixture', 'name': name}
+        try:
+            ancestor, base, other = (parser.parse_file(path)[0] for path in paths)
+        except parse.ParseError as e:
+            result['skipped'] = str(e)
+        else:
+            result['nodes'] = [ancestor.size, base.size, other.size]
+            result['phases'] = benchmark_trees(ancestor, base, other, runs)
+        yield result
+
+
+def environment() -> typing.Dict[str, str]:
+    """Describes the environment of a benchmark run, so results of different releases can be compared."""
+    return {
+        'checkmerge': f"{app.CheckMerge.version} ({app.CheckMerge.build})",
+        'python': sys.version.split()[0],
+        'platform': sys.platform,
+    }
+
@@ -0,0 +1,33 @@
+import unittest
+
+from checkmerge.benchmarks import suite
+from checkmerge.benchmarks.generate import TreeGenerator
+
+
+class TreeGeneratorTestCase(unittest.TestCase):
+    def test_tree(self):
+        """Tests that trees of the requested size and depth are generated deterministically."""
+        tree = TreeGenerator(seed=1, depth=5).tree(500)
+        same = TreeGenerator(seed=1, depth=5).tree(500)
+
+        self.assertEqual(500, tree.size)
+        self.assertLessEqual(tree.height, 6)
+        self.assertEqual(tree.hash, same.hash)
+        self.assertNotEqual(tree.hash, TreeGenerator(seed=2, depth=5).tree(500).hash)
+
+    def test_edit(self):
+        """Tests that edits are made to a copy of the tree."""
+        generator = TreeGenerator(seed=1)
+        tree = generator.tree(200)
+        labels = [n.label for n in tree.subtree()]
+
+        edited = generator.edit(tree, 10)
+
+        self.assertEqual(labels, [n.label for n in tree.subtree()])
+        self.assertNotEqual(tree.hash, edited.hash)
+
+    def test_synthetic(self):
+        """Tests that the synthetic benchmark measures every phase."""
+        result = suite.synthetic(200, seed=1)
+        self.assertEqual({'top_down', 'bottom_up', 'opt', 'calculate_changes', 'dependence_analysis',
+                          'reference_analysis'}, set(result['phases']))
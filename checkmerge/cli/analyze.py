@@ -1,32 +1,81 @@
+import glob
+import json
+import os
+import typing
+
 import click
 
-from checkmerge.analysis.report import AnalysisReport
-from checkmerge.app import CheckMerge
+from checkmerge import diff
+from checkmerge.analysis import AnalysisResult
+from checkmerge.analysis.report import AnalysisReport, StreamingAnalysisReport, metric_as_dict, result_as_dict
+from checkmerge.app import CheckMerge, RunConfig
 from checkmerge.cli import cli, error, pass_app
 from checkmerge.cli.formatting import CheckMergeFormatter
+from checkmerge.ir import DotWriter, neighbourhood
 from checkmerge.parse import ParseError
+from checkmerge.parse.git import GitRepository
 from checkmerge.plugins import registry
+from checkmerge.util.trace import tracer
 
 
 @cli.command()
 @click.option('--parser', '-p', 'parser', type=click.STRING, required=True,
               help="The parser to use. Run `list-parsers` to see the available parsers.")
+@click.option('--diff', '-d', 'diff_algorithm', type=click.STRING, default='gumtree',
+              help="The diff algorithm to use. Run `list-diff-algorithms` to see the available algorithms.")
 @click.option('--analysis', '-a', 'analysis', type=click.STRING, required=True, multiple=True,
               help="The analysis to perform. Repeat this option to perform multiple analysis."
                    "Run `list-analysis` to see the available analysis.")
 @click.option('--time/--no-time', 'time', default=False, help="Whether to show run times of different operations.")
 @click.option('--stats/--no-stats', 'stats', default=False, help="Whether to show statistics.")
+@click.option('--cache/--no-cache', 'cache', default=True, help="Whether to use the cache of parsed programs.")
+@click.option('--cache-dir', 'cache_dir', type=click.Path(file_okay=False, resolve_path=True), default=None,
+              help="The directory of the cache of parsed programs.")
+@click.option('--parallel/--no-parallel', 'parallel', default=False,
+              help="Whether to parse and diff the programs in parallel worker processes.")
+@click.option('--parallel-analysis', 'parallel_analysis', type=click.Choice(['threads', 'processes']), default=None,
+              help="Run the analyses concurrently in threads or in worker processes.")
+@click.option('--diff-time-budget', 'time_budget', type=click.FLOAT, default=None,
+              help="The number of seconds a diff may take. The results are approximate if the budget runs out. Only "
+                   "supported by the GumTree and sharded diff algorithms.")
+@click.option('--diff-work-budget', 'work_budget', type=click.INT, default=None,
+              help="The number of nodes the bottom up phase of a diff may visit. The results are approximate if the "
+                   "budget runs out. Only supported by the GumTree and sharded diff algorithms.")
+@click.option('--pch/--no-pch', 'pch', default=False,
+              help="Whether to leave the headers included at the start of the programs out of the analysis by "
+                   "precompiling them. This changes the results, as changes to these headers are not detected. Only "
+                   "supported by the Clang parser.")
+@click.option('--trace', 'trace', type=click.Path(dir_okay=False, writable=True), default=None,
+              help="File to write a trace of the run to, in the Chrome trace event format.")
+@click.option('--format', '-f', 'output_format', type=click.Choice(['report', 'text', 'jsonl']), default='report',
+              show_default=True, help="The output format. The report is written once the analysis is done, sorted by "
+                                      "severity. The text and JSON Lines formats write every result as soon as it is "
+                                      "found and the metrics at the end.")
+@click.option('--fail-on', 'fail_on', type=click.FLOAT, default=None,
+              help="Exit with status 1 if a result has at least this severity. When streaming, the analysis stops at "
+                   "the first such result.")
+@click.option('--graph-dir', 'graph_dir', type=click.Path(file_okay=False, resolve_path=True), default=None,
+              help="Directory to write a GraphViz DOT file with the neighbourhood of the changed nodes of every result "
+                   "to.")
+@click.option('--graph-hops', 'graph_hops', type=click.INT, default=1, show_default=True,
+              help="The number of dependencies to follow from the changed nodes in the graphs of the results.")
 @click.argument('base', type=click.Path(exists=True, dir_okay=False, resolve_path=True))
 @click.argument('compared', type=click.Path(exists=True, dir_okay=False, resolve_path=True))
 @click.argument('ancestor', required=False, type=click.Path(exists=True, dir_okay=False, resolve_path=True))
 @pass_app
-def analyze(app: CheckMerge, parser, analysis, base, compared, ancestor, time, stats):
+def analyze(app: CheckMerge, parser, diff_algorithm, analysis, base, compared, ancestor, time, stats, cache,
+            cache_dir, parallel, parallel_analysis, time_budget, work_budget, pch, trace, output_format, fail_on,
+            graph_dir, graph_hops):
     """Analyze the differences between the given programs."""
+    if trace:
+        tracer.enable()
+
     app.start_timer('Total')
 
-    # Set parser
+    # Set parser and diff algorithm
     try:
         app.parser = parser
+        app.diff_algorithm = diff_algorithm
     except ValueError as e:
         return error(e)
 
@@ -34,6 +83,15 @@ def analyze(app: CheckMerge, parser, analysis, base, compared, ancestor, time, s
     if app.parser is None or app.diff_algorithm is None:
         return error("Unexpected configuration error.")
 
+    # Configure the cache of parsed programs and parallelism
+    app.set_options(cache=cache, cache_dir=cache_dir, parallel=parallel, parallel_analysis=parallel_analysis)
+    if pch:
+        app.set_options(parser_options=dict(precompile_headers=True))
+    if time_budget is not None or work_budget is not None:
+        if not app.diff_algorithm.budgeted:
+            return error(f"The diff algorithm '{app.diff_algorithm.key}' does not support a budget.")
+        app.set_options(diff_options=dict(time_budget=time_budget, work_budget=work_budget))
+
     # Set versions to diff
     versions = tuple(v for v in (base, compared, ancestor) if v is not None)
 
@@ -57,21 +115,45 @@ def analyze(app: CheckMerge, parser, analysis, base, compared, ancestor, time, s
         else:
             config = config.analyze(analysis_cls)
 
-    # Do analysis
-    with app.time('Analysis'):
-        results = list(config.analysis())
-
     formatter = CheckMergeFormatter()
+    stream = StreamingAnalysisReport(fail_on=fail_on)
 
-    with app.time('Report'):
-        # Build report
-        report = AnalysisReport(results)
+    if output_format == 'report':
+        # Do analysis
+        with app.time('Analysis'):
+            results = list(config.analysis())
+            for k, result in enumerate(results):
+                stream.add(result)
+                if graph_dir:
+                    _write_graph(result, k, graph_dir, graph_hops)
 
-        # Write report
-        formatter.write_report(report)
+        with app.time('Report'):
+            # Build report
+            report = AnalysisReport(results)
+
+            # Write report
+            formatter.write_report(report)
+            if config.changes().approximate:
+                formatter.write_truncated(config.changes())
+    else:
+        # Do analysis and write every result as soon as it is found
+        with app.time('Analysis'):
+            for k, result in enumerate(config.analysis()):
+                _write_result(result, output_format)
+                if graph_dir:
+                    _write_graph(result, k, graph_dir, graph_hops)
+                if stream.add(result):
+                    break
+
+        with app.time('Report'):
+            _write_metrics(stream, config.changes(), output_format)
 
     app.stop_timer('Total')
 
+    if trace:
+        tracer.disable()
+        tracer.write_chrome_trace(trace)
+
     # Write timings and stats
     if time:
         with formatter.section('Timing results'):
@@ -82,23 +164,225 @@ def analyze(app: CheckMerge, parser, analysis, base, compared, ancestor, time, s
                 ('Number of AST nodes', str(config.changes().node_count)),
                 ('Number of changes', str(config.changes().change_count)),
             ))
+            if trace:
+                formatter.write_dl((name, str(value)) for name, value in sorted(tracer.counters.items()))
 
     click.echo(formatter.getvalue(), nl=False)
 
+    if stream.failed:
+        click.get_current_context().exit(1)
+
+
+def _write_result(result: AnalysisResult, output_format: str) -> None:
+    """Writes a single analysis result in a streaming output format."""
+    if output_format == 'jsonl':
+        click.echo(json.dumps({'result': result_as_dict(result)}))
+    else:
+        formatter = CheckMergeFormatter()
+        formatter.write_conflict(result)
+        click.echo(formatter.getvalue(), nl=False)
+
+
+def _write_graph(result: AnalysisResult, k: int, graph_dir: str, hops: int) -> None:
+    """Writes the neighbourhood of the changed nodes of an analysis result to a numbered DOT file."""
+    changed = result.get_changed_base_nodes() | result.get_changed_other_nodes()
+    nodes = neighbourhood(changed | result.base_nodes | result.other_nodes, hops)
+
+    os.makedirs(graph_dir, exist_ok=True)
+    with open(os.path.join(graph_dir, f'{k:04d}-{result.key}.dot'), 'w') as f:
+        with DotWriter(f, str(result)) as writer:
+            writer.write_nodes(nodes, highlight=changed)
+
+
+def _write_metrics(report: StreamingAnalysisReport, changes: diff.DiffResult, output_format: str) -> None:
+    """
+    Writes the metrics of the streamed analysis results in a streaming output format, with the phases of the diff that
+    were cut short by its budget.
+    """
+    if output_format == 'jsonl':
+        click.echo(json.dumps({'metrics': [metric_as_dict(metric) for metric in report.get_metrics()],
+                               'truncated': sorted(changes.truncated)}))
+    else:
+        formatter = CheckMergeFormatter()
+        with formatter.section('Metrics'):
+            for metric in report.get_metrics():
+                formatter.write_metric(metric)
+        if changes.approximate:
+            formatter.write_truncated(changes)
+        click.echo(formatter.getvalue(), nl=False)
+
 
 @cli.command()
 @click.option('--parser', '-p', 'parser', type=click.STRING, required=False,
               help="The parser to use. Run `list-parsers` to see the available parsers.")
+@click.option('--diff', '-d', 'diff_algorithm', type=click.STRING, required=False,
+              help="The diff algorithm to use. Run `list-diff-algorithms` to see the available algorithms.")
 @click.option('--analysis', '-a', 'analysis', type=click.STRING, required=False, multiple=True,
               help="The analysis to perform. Repeat this option to perform multiple analysis."
                    "Run `list-analysis` to see the available analysis.")
 @click.argument('test_dir', type=click.Path(exists=True, file_okay=False, resolve_path=True))
 @click.argument('file_name', type=click.STRING)
 @click.pass_context
-def test(ctx: click.Context, file_name, test_dir, parser=None, analysis=None):
+def test(ctx: click.Context, file_name, test_dir, parser=None, diff_algorithm=None, analysis=None):
     """Run a test. Finds the test files in the specified directory. The file name of the test must be relative to a
     version directory in the test directory."""
     parser = parser or 'clang'
+    diff_algorithm = diff_algorithm or 'gumtree'
     analysis = analysis or ['dependence', 'reference']
-    ctx.invoke(analyze, parser=parser, analysis=analysis, base=f"{test_dir}/a/{file_name}",
+    ctx.invoke(analyze, parser=parser, diff_algorithm=diff_algorithm, analysis=analysis, base=f"{test_dir}/a/{file_name}",
                compared=f"{test_dir}/b/{file_name}", ancestor=f"{test_dir}/0/{file_name}", time=True, stats=True)
+
+
+@cli.command('analyze-batch')
+@click.option('--parser', '-p', 'parser', type=click.STRING, required=True,
+              help="The parser to use. Run `list-parsers` to see the available parsers.")
+@click.option('--diff', '-d', 'diff_algorithm', type=click.STRING, default='gumtree',
+              help="The diff algorithm to use. Run `list-diff-algorithms` to see the available algorithms.")
+@click.option('--analysis', '-a', 'analysis', type=click.STRING, required=True, multiple=True,
+              help="The analysis to perform. Repeat this option to perform multiple analysis."
+                   "Run `list-analysis` to see the available analysis.")
+@click.option('--jobs', '-j', 'workers', type=click.INT, default=None,
+              help="The number of worker processes. Defaults to the number of processors.")
+@click.option('--list', '-l', 'job_list', type=click.File('r'), default=None,
+              help="File with a job on every line: the paths of the base, compared and (optional) ancestor programs, "
+                   "separated by whitespace. Use - to read from the standard input.")
+@click.option('--test-dir', '-t', 'test_dir', type=click.Path(exists=True, file_okay=False, resolve_path=True),
+              default=None, help="Test directory with the versions of the programs in the a, b and 0 directories.")
+@click.option('--pattern', 'pattern', type=click.STRING, default='**/*.c', show_default=True,
+              help="Glob pattern for the programs in the test directory, relative to the version directories.")
+@click.option('--cache/--no-cache', 'cache', default=True, help="Whether to use the cache of parsed programs.")
+@click.option('--cache-dir', 'cache_dir', type=click.Path(file_okay=False, resolve_path=True), default=None,
+              help="The directory of the cache of parsed programs.")
+@click.option('--pch/--no-pch', 'pch', default=False,
+              help="Whether to leave the headers included at the start of the programs out of the analysis by "
+                   "precompiling them. This changes the results, as changes to these headers are not detected. Only "
+                   "supported by the Clang parser.")
+@pass_app
+def analyze_batch(app: CheckMerge, parser, diff_algorithm, analysis, workers, job_list, test_dir, pattern, cache,
+                  cache_dir, pch):
+    """Analyze the differences between many programs in parallel. The report of each job is written as soon as it is
+    finished."""
+    # Set parser and diff algorithm
+    try:
+        app.parser = parser
+        app.diff_algorithm = diff_algorithm
+    except ValueError as e:
+        return error(e)
+
+    app.set_options(cache=cache, cache_dir=cache_dir)
+    if pch:
+        app.set_options(parser_options=dict(precompile_headers=True))
+
+    analysis_classes = []
+    for key in analysis:
+        analysis_cls = registry.analysis.find(key)
+        if analysis_cls is None:
+            return error(f"No analysis with name '{key}' has been found.")
+        analysis_classes.append(analysis_cls)
+
+    # Collect jobs
+    jobs = []
+    if job_list is not None:
+        for number, line in enumerate(job_list, 1):
+            paths = line.split()
+            if not paths:
+                continue
+            if len(paths) not in (2, 3):
+                return error(f"Line {number} of the job list does not contain two or three paths.")
+            jobs.append(tuple(os.path.abspath(path) for path in paths) + (None,) * (3 - len(paths)))
+    if test_dir is not None:
+        for path in sorted(glob.glob(os.path.join(test_dir, 'a', pattern), recursive=True)):
+            name = os.path.relpath(path, os.path.join(test_dir, 'a'))
+            ancestor = os.path.join(test_dir, '0', name)
+            jobs.append((path, os.path.join(test_dir, 'b', name), ancestor if os.path.exists(ancestor) else None))
+    if not jobs:
+        return error("No jobs given, use --list or --test-dir.")
+
+    # Run jobs and stream the reports
+    failures = total = 0
+    for result in app.batch(jobs, analysis_classes, _batch_report, workers=workers):
+        formatter = CheckMergeFormatter()
+        with formatter.section(' '.join(path for path in result.job if path is not None)):
+            if result.error is not None:
+                failures += 1
+                formatter.write_text(f"Error: {result.error}")
+            else:
+                total += result.count
+                formatter.write_text(result.report, False)
+        click.echo(formatter.getvalue(), nl=False)
+
+    click.echo(f"{len(jobs)} jobs, {failures} failed, {total} analysis results.")
+
+    if failures:
+        click.get_current_context().exit(1)
+
+
+def _batch_report(config: RunConfig, results: typing.List[AnalysisResult]) -> str:
+    """Formats the report of a job of a batch run. Runs in the worker processes."""
+    formatter = CheckMergeFormatter()
+    formatter.write_report(AnalysisReport(results))
+    return formatter.getvalue().rstrip()
+
+
+@cli.command('analyze-git')
+@click.option('--parser', '-p', 'parser', type=click.STRING, required=True,
+              help="The parser to use. Run `list-parsers` to see the available parsers.")
+@click.option('--diff', '-d', 'diff_algorithm', type=click.STRING, default='gumtree',
+              help="The diff algorithm to use. Run `list-diff-algorithms` to see the available algorithms.")
+@click.option('--analysis', '-a', 'analysis', type=click.STRING, required=True, multiple=True,
+              help="The analysis to perform. Repeat this option to perform multiple analysis."
+                   "Run `list-analysis` to see the available analysis.")
+@click.option('--repo', '-r', 'repo', type=click.Path(exists=True, file_okay=False), default='.',
+              help="A directory within the git repository.")
+@click.option('--analysis-dir', 'analysis_dir', type=click.Path(exists=True, file_okay=False, resolve_path=True),
+              default=None, help="Directory with analysis files named after the blob hashes of the programs.")
+@click.option('--cache/--no-cache', 'cache', default=True, help="Whether to use the cache of parsed programs.")
+@click.option('--cache-dir', 'cache_dir', type=click.Path(file_okay=False, resolve_path=True), default=None,
+              help="The directory of the cache of parsed programs.")
+@click.option('--pch/--no-pch', 'pch', default=False,
+              help="Whether to leave the headers included at the start of the programs out of the analysis by "
+                   "precompiling them. This changes the results, as changes to these headers are not detected. Only "
+                   "supported by the Clang parser.")
+@click.argument('base', type=click.STRING)
+@click.argument('compared', type=click.STRING)
+@click.argument('files', type=click.STRING, nargs=-1, required=True)
+@pass_app
+def analyze_git(app: CheckMerge, parser, diff_algorithm, analysis, repo, analysis_dir, cache, cache_dir, pch, base,
+                compared, files):
+    """Analyze a merge of two git revisions. The versions of the given files in both revisions and their merge base
+    are read from the repository, without checking them out."""
+    # Set parser and diff algorithm
+    try:
+        app.parser = parser
+        app.diff_algorithm = diff_algorithm
+    except ValueError as e:
+        return error(e)
+
+    app.set_options(cache=cache, cache_dir=cache_dir)
+    if pch:
+        app.set_options(parser_options=dict(precompile_headers=True))
+
+    analysis_classes = []
+    for key in analysis:
+        analysis_cls = registry.analysis.find(key)
+        if analysis_cls is None:
+            return error(f"No analysis with name '{key}' has been found.")
+        analysis_classes.append(analysis_cls)
+
+    # All files share the parser of the initial configuration
+    config = app.build_config()
+
+    with GitRepository(repo, analysis_dir=analysis_dir) as git:
+        for file in files:
+            try:
+                file_config = config.parse(*git.merge_sources(base, compared, file)).diff()
+            except ParseError as e:
+                return error(e)
+
+            for analysis_cls in analysis_classes:
+                file_config = file_config.analyze(analysis_cls)
+
+            formatter = CheckMergeFormatter()
+            with formatter.section(file):
+                formatter.write_report(AnalysisReport(file_config.analysis()))
+            click.echo(formatter.getvalue(), nl=False)
@@ -0,0 +1,52 @@
+import json
+
+import click
+
+from checkmerge.app import CheckMerge
+from checkmerge.benchmarks import suite
+from checkmerge.cli import cli, error, pass_app
+
+
+@cli.command()
+@click.option('--size', '-s', 'sizes', type=click.INT, multiple=True, default=(1000, 10000, 100000), show_default=True,
+              help="The number of nodes of the synthetic trees. Repeat this option to run multiple sizes.")
+@click.option('--seed', 'seed', type=click.INT, default=0, show_default=True, help="The seed of the tree generator.")
+@click.option('--edits', 'edits', type=click.INT, default=None,
+              help="The number of edits of each version of a synthetic tree. Defaults to 1% of the size.")
+@click.option('--depth', 'depth', type=click.INT, default=12, show_default=True,
+              help="The maximum depth of the synthetic trees.")
+@click.option('--repeat-density', 'repeat_density', type=click.FLOAT, default=0.1, show_default=True,
+              help="The probability that a subtree of a synthetic tree is a copy of another subtree.")
+@click.option('--dependency-density', 'dependency_density', type=click.FLOAT, default=0.2, show_default=True,
+              help="The expected number of dependencies per node of a synthetic tree.")
+@click.option('--runs', '-r', 'runs', type=click.INT, default=1, show_default=True,
+              help="The number of runs of every phase, of which the fastest is reported.")
+@click.option('--parser', '-p', 'parser', type=click.STRING, default=None,
+              help="The parser for the test programs. The test programs are only benchmarked if a parser is given.")
+@click.option('--test-dir', '-t', 'test_dir', type=click.Path(exists=True, file_okay=False, resolve_path=True),
+              default=None, help="Test directory with the versions of the programs in the a, b and 0 directories.")
+@click.option('--output', '-o', 'output', type=click.File('w'), default='-',
+              help="The file to write the JSON results to. Defaults to the standard output.")
+@pass_app
+def benchmark(app: CheckMerge, sizes, seed, edits, depth, repeat_density, dependency_density, runs, parser,
+              test_dir, output):
+    """Benchmark the phases of the diff and the analysis. Measures GumTree top down, bottom up and opt, the
+    calculation of changes, and the dependence and reference analysis on synthetic trees and, optionally, on the test
+    programs. The results are written as JSON."""
+    results = []
+
+    if parser is not None:
+        if test_dir is None:
+            return error("A test directory is required to benchmark the test programs.")
+        try:
+            app.parser = parser
+        except ValueError as e:
+            return error(e)
+        results.extend(suite.fixtures(app.build_config().parser_instance, test_dir, runs))
+
+    for size in sizes:
+        results.append(suite.synthetic(size, seed=seed, edits=edits, runs=runs, depth=depth,
+                                       repeat=repeat_density, dependencies=dependency_density))
+
+    json.dump({'environment': suite.environment(), 'results': results}, output, indent=2)
+    output.write('\n')
@@ -0,0 +1,83 @@
+import json
+
+import click
+
+from checkmerge.app import CheckMerge
+from checkmerge.cli import cli, error, pass_app
+from checkmerge.daemon import Daemon, default_socket, request
+
+
+@cli.command()
+@click.option('--socket', '-s', 'path', type=click.Path(dir_okay=False), default=None,
+              help="The path of the socket. Defaults to $CHECKMERGE_SOCKET or a file in the temporary directory.")
+@click.option('--cache/--no-cache', 'cache', default=True, help="Whether to use the cache of parsed programs.")
+@click.option('--cache-dir', 'cache_dir', type=click.Path(file_okay=False, resolve_path=True), default=None,
+              help="The directory of the cache of parsed programs.")
+@click.option('--pch/--no-pch', 'pch', default=False,
+              help="Whether to precompile and share the headers of the programs. Only supported by the Clang parser.")
+@click.option('--max-trees', 'max_trees', type=click.IntRange(min=3), default=64, show_default=True,
+              help="The maximum number of parsed programs to keep in memory.")
+@click.option('--max-diffs', 'max_diffs', type=click.IntRange(min=1), default=128, show_default=True,
+              help="The maximum number of diffs to keep in memory.")
+@click.option('--status', 'command', flag_value='status', help="Show the status of a running daemon instead.")
+@click.option('--stop', 'command', flag_value='shutdown', help="Stop a running daemon instead.")
+@pass_app
+def daemon(app: CheckMerge, path, cache, cache_dir, pch, max_trees, max_diffs, command):
+    """Run a daemon serving analyze requests over a socket. The daemon keeps the most recently used parsed programs
+    and their diffs in memory and only parses and diffs programs again once they change. The analyses are run again on
+    the whole merge for every changed merge, not only on the changed declarations. Send requests with
+    `analyze-daemon`."""
+    path = path or default_socket()
+
+    if command is not None:
+        try:
+            response = request(path, {'command': command}, timeout=10)
+        except OSError as e:
+            return error(f"Unable to connect to the daemon at {path}: {e}")
+        click.echo(json.dumps(response))
+        return
+
+    app.set_options(cache=cache, cache_dir=cache_dir)
+    if pch:
+        app.set_options(parser_options=dict(precompile_headers=True))
+
+    click.echo(f"Serving on {path}", err=True)
+    Daemon(app, path, max_trees=max_trees, max_diffs=max_diffs).serve()
+
+
+@cli.command('analyze-daemon')
+@click.option('--socket', '-s', 'path', type=click.Path(dir_okay=False), default=None,
+              help="The path of the socket. Defaults to $CHECKMERGE_SOCKET or a file in the temporary directory.")
+@click.option('--parser', '-p', 'parser', type=click.STRING, required=True,
+              help="The parser to use. Run `list-parsers` to see the available parsers.")
+@click.option('--diff', '-d', 'diff_algorithm', type=click.STRING, default='gumtree',
+              help="The diff algorithm to use. Run `list-diff-algorithms` to see the available algorithms.")
+@click.option('--analysis', '-a', 'analysis', type=click.STRING, required=True, multiple=True,
+              help="The analysis to perform. Repeat this option to perform multiple analysis."
+                   "Run `list-analysis` to see the available analysis.")
+@click.option('--fail-on', 'fail_on', type=click.FLOAT, default=None,
+              help="Exit with status 1 if a result has at least this severity.")
+@click.argument('base', type=click.Path(exists=True, dir_okay=False, resolve_path=True))
+@click.argument('compared', type=click.Path(exists=True, dir_okay=False, resolve_path=True))
+@click.argument('ancestor', required=False, type=click.Path(exists=True, dir_okay=False, resolve_path=True))
+def analyze_daemon(path, parser, diff_algorithm, analysis, fail_on, base, compared, ancestor):
+    """Analyze the differences between the given programs with a running daemon. The results and metrics are written
+    as JSON Lines."""
+    path = path or default_socket()
+    versions = [v for v in (base, compared, ancestor) if v is not None]
+
+    try:
+        response = request(path, {'command': 'analyze', 'parser': parser, 'diff': diff_algorithm,
+                                  'analysis': list(analysis), 'versions': versions})
+    except OSError as e:
+        return error(f"Unable to connect to the daemon at {path}: {e}")
+
+    if 'error' in response:
+        return error(response['error'])
+
+    for result in response['results']:
+        click.echo(json.dumps({'result': result}))
+    click.echo(json.dumps({'metrics': response['metrics']}))
+
+    if fail_on is not None and any(result['severity'] >= fail_on for result in response['results']):
+        click.get_current_context().exit(1)
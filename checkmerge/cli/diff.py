@@ -6,18 +6,30 @@ from checkmerge.parse import ParseError
 @cli.command()
 @click.option('--parser', '-p', 'parser', type=click.STRING, required=True,
               help="The parser to use. Run `list-parsers` to see the available parsers.")
+@click.option('--diff', '-d', 'diff_algorithm', type=click.STRING, default='gumtree',
+              help="The diff algorithm to use. Run `list-diff-algorithms` to see the available algorithms.")
+@click.option('--cache/--no-cache', 'cache', default=True, help="Whether to use the cache of parsed programs.")
+@click.option('--cache-dir', 'cache_dir', type=click.Path(file_okay=False, resolve_path=True), default=None,
+              help="The directory of the cache of parsed programs.")
+@click.option('--parallel/--no-parallel', 'parallel', default=False,
+              help="Whether to parse and diff the programs in parallel worker processes.")
+@click.option('--pch/--no-pch', 'pch', default=False,
+              help="Whether to leave the headers included at the start of the programs out of the analysis by "
+                   "precompiling them. This changes the results, as changes to these headers are not detected. Only "
+                   "supported by the Clang parser.")
 @click.argument('base', type=click.Path(exists=True, dir_okay=False, resolve_path=True))
 @click.argument('compared', type=click.Path(exists=True, dir_okay=False, resolve_path=True))
 @click.argument('ancestor', required=False, type=click.Path(exists=True, dir_okay=False, resolve_path=True))
 @pass_app
-def diff(app: CheckMerge, parser, base, compared, ancestor):
+def diff(app: CheckMerge, parser, diff_algorithm, base, compared, ancestor, cache, cache_dir, parallel, pch):
     """Calculate and output the differences between the given programs.
 
     The difference between the programs is calculated using the CheckMerge abstract syntax tree (AST) based diff
     algorithm."""
-    # Set parser
+    # Set parser and diff algorithm
     try:
         app.parser = parser
+        app.diff_algorithm = diff_algorithm
     except ValueError as e:
         return error(e)
 
@@ -25,6 +37,11 @@ def diff(app: CheckMerge, parser, base, compared, ancestor):
     if app.parser is None or app.diff_algorithm is None:
         return error("Unexpected configuration error.")
 
+    # Configure the cache of parsed programs and parallelism
+    app.set_options(cache=cache, cache_dir=cache_dir, parallel=parallel)
+    if pch:
+        app.set_options(parser_options=dict(precompile_headers=True))
+
     # Set versions to diff
     versions = tuple(v for v in (base, compared, ancestor) if v is not None)
 
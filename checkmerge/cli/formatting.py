@@ -187,6 +187,12 @@ class CheckMergeFormatter(click.HelpFormatter):
     def write_metric(self, metric: report.Metric):
         self.write_dl(self.get_metric_dl(metric))
 
+    def write_truncated(self, changes: diff.DiffResult):
+        with self.section('Warning'):
+            phases = ', '.join(sorted(changes.truncated))
+            self.write_text(click.style(f"The diff ran out of budget and cut short the following phases: {phases}. "
+                                        f"The results are approximate.", fg='yellow'))
+
     def write_report(self, data: report.Report):
         if data.has_metrics:
             for metric in data.get_metrics():
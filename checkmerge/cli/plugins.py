@@ -15,6 +15,10 @@ class PluginDataFormatter(click.HelpFormatter):
 @click.option('--disabled', is_flag=True, default=False, help="Show disabled plugins.")
 def list_plugins(disabled):
     """Lists the available plugins."""
+    # Load all declared classes to find out which plugins can be set up
+    for sub_registry in (registry.parsers, registry.analysis, registry.diff):
+        sub_registry.all()
+
     all_plugins = [plugin for plugin in registry.registry.values()]
     enabled_plugins = [plugin for plugin in all_plugins if not plugin.disabled]
     disabled_plugins = [plugin for plugin in all_plugins if plugin.disabled]
@@ -53,7 +57,7 @@ def list_plugins(disabled):
 @cli.command('list-parsers')
 def list_parsers():
     """Lists the available parsers."""
-    parsers = registry.parsers.all()
+    parsers = registry.parsers.describe()
 
     if parsers:
         formatter = PluginDataFormatter()
@@ -72,7 +76,7 @@ def list_parsers():
 @cli.command('list-analysis')
 def list_analysis():
     """Lists the available analysis algorithms."""
-    analysis = registry.analysis.all()
+    analysis = registry.analysis.describe()
 
     if analysis:
         formatter = PluginDataFormatter()
@@ -86,3 +90,22 @@ def list_analysis():
         click.echo(formatter.getvalue(), nl=False)
     else:
         click.echo("No analysis algorithms available. Run 'list-plugins --disabled' to see the disabled plugins.")
+
+
+@cli.command('list-diff-algorithms')
+def list_diff_algorithms():
+    """Lists the available diff algorithms."""
+    algorithms = registry.diff.describe()
+
+    if algorithms:
+        formatter = PluginDataFormatter()
+        indent = formatter.indent_increment * ' '
+
+        formatter.write_text(f"Available diff algorithms:{indent}{len(algorithms)}")
+
+        for algorithm in algorithms:
+            formatter.write_plugin_obj(algorithm)
+
+        click.echo(formatter.getvalue(), nl=False)
+    else:
+        click.echo("No diff algorithms available. Run 'list-plugins --disabled' to see the disabled plugins.")
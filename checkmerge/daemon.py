@@ -0,0 +1,282 @@
+import json
+import os
+import socket
+import socketserver
+import tempfile
+import time
+import typing
+
+from checkmerge import diff, ir, plugins
+from checkmerge.analysis.report import StreamingAnalysisReport, metric_as_dict, result_as_dict
+from checkmerge.app import CheckMerge, RunConfig
+from checkmerge.parse import ParseError
+from checkmerge.util.collections import LRUCache
+
+
+# Type definitions
+Request = typing.Dict[str, typing.Any]
+Response = typing.Dict[str, typing.Any]
+
+
+class DaemonError(Exception):
+    """Error in a request to the daemon, which is reported to the client."""
+
+
+class Daemon(object):
+    """
+    Long-running process serving analyze requests over a Unix socket, which keeps the parsed trees and the diff results
+    resident between requests.
+
+    A tree is kept for every file and parser, together with the modification time and size of the file, and the file is
+    only parsed again once these change. Diffs are kept by the diffed trees (see the `diff_cache` option of
+    `RunConfig`), so when a single version of a merge changes, only the diffs with that version are run again. The
+    analysis results of the last request are kept as well and returned as is when the same merge is analyzed again
+    without changes. Otherwise the analyses run on the whole merge, also if only some declarations have changed.
+
+    Both the trees and the diff results are bounded in number. The least recently used tree is removed together with
+    its diff results once the limit is reached, and so is the least recently used diff result.
+
+    The protocol is line based: every request and every response is a single JSON object on a line. Requests are
+    handled one at a time, as the trees are shared between requests.
+    """
+
+    def __init__(self, app: CheckMerge, path: str, max_trees: int = 64, max_diffs: int = 128):
+        """
+        :param app: The application with the options of the configurations, such as the parse cache.
+        :param path: The path of the socket.
+        :param max_trees: The maximum number of resident trees, at least the three versions of a merge.
+        :param max_diffs: The maximum number of resident diff results.
+        """
+        if max_trees < 3:
+            raise ValueError("The daemon must keep at least the three trees of a merge.")
+        self.app = app
+        self.path = path
+        self.started = time.time()
+        self.requests = 0
+
+        # Configurations by parser and diff algorithm, sharing a parser instance per configuration
+        self.configs: typing.Dict[typing.Tuple[str, str], RunConfig] = {}
+
+        # Trees by parser and path, with the modification time and size of the file
+        self.trees: typing.MutableMapping[typing.Tuple[str, str], typing.Tuple[typing.Tuple[int, int], ir.Node]] = \
+            LRUCache(max_trees, on_evict=lambda key, entry: self.evict(entry[1]))
+
+        # Diff results by diff algorithm and trees, shared by all configurations
+        self.diff_cache: typing.MutableMapping[typing.Tuple, diff.DiffResult] = LRUCache(max_diffs)
+
+        # The key, tagged configuration and analysis results of the last analyzed merge
+        self.last: typing.Optional[typing.Tuple[typing.Tuple, RunConfig, typing.Dict[str, list]]] = None
+
+        self._stopped = False
+
+    def config(self, parser: str, diff_algorithm: str) -> RunConfig:
+        """
+        :param parser: The key of the parser.
+        :param diff_algorithm: The key of the diff algorithm.
+        :return: The configuration for the given parser and diff algorithm.
+        """
+        key = (parser, diff_algorithm)
+        if key not in self.configs:
+            parser_cls = plugins.registry.parsers.find(parser)
+            diff_cls = plugins.registry.diff.find(diff_algorithm)
+            if parser_cls is None:
+                raise DaemonError(f"No parser with name '{parser}' has been found.")
+            if diff_cls is None:
+                raise DaemonError(f"No diff algorithm with name '{diff_algorithm}' has been found.")
+            options = dict(self.app.options, parallel=False, diff_cache=self.diff_cache)
+            self.configs[key] = RunConfig(parser_cls, diff_cls, **options)
+        return self.configs[key]
+
+    def tree(self, config: RunConfig, path: str) -> ir.Node:
+        """
+        Returns the resident tree of a file, which is parsed if the file is new or has changed since it was parsed.
+
+        :param config: The configuration with the parser to use.
+        :param path: The path of the file.
+        :return: The tree of the file.
+        """
+        try:
+            stat = os.stat(path)
+        except OSError as e:
+            raise DaemonError(f"Unable to read {path}: {e.strerror}")
+
+        stamp = (stat.st_mtime_ns, stat.st_size)
+        key = (config.parser.key, path)
+        entry = self.trees.get(key)
+
+        if entry is None or entry[0] != stamp:
+            if entry is not None:
+                self.evict(entry[1])
+            self.trees[key] = entry = (stamp, config.parse_tree(path))
+        return entry[1]
+
+    def evict(self, root: ir.Node) -> None:
+        """
+        Removes the diff results and the analysis results of an outdated tree, and releases its flat representation.
+
+        :param root: The outdated tree.
+        """
+        # Keys are the diff algorithm, the diffed trees and the options of the diff algorithm
+        for key in [key for key in self.diff_cache if root in key[1:4]]:
+            del self.diff_cache[key]
+        if self.last is not None and root in self.last[0]:
+            self.reset()
+
+        # Break the references between the root and its flat tree, so the tree is freed once it is dropped
+        root.release_flat()
+
+    def reset(self) -> None:
+        """Removes the change information of the last analyzed merge from its trees."""
+        if self.last is not None:
+            diff.untag_nodes(self.last[1].changes())
+            self.last = None
+
+    def analyze(self, request: Request) -> Response:
+        """
+        Analyzes a merge.
+
+        :param request: The request with the `parser`, `diff` and `analysis` keys and the paths of the base, other and
+                        (optional) ancestor programs as `versions`.
+        :return: The response with the `results`, the `metrics` and the `truncated` phases of the diffs.
+        """
+        parser, diff_algorithm = request.get('parser'), request.get('diff', 'gumtree')
+        versions = request.get('versions') or []
+        if parser is None or len(versions) not in (2, 3):
+            raise DaemonError("A request requires a parser and two or three versions.")
+
+        analysis_classes = []
+        for key in request.get('analysis') or []:
+            analysis_cls = plugins.registry.analysis.find(key)
+            if analysis_cls is None:
+                raise DaemonError(f"No analysis with name '{key}' has been found.")
+            analysis_classes.append(analysis_cls)
+
+        config = self.config(parser, diff_algorithm)
+        try:
+            trees = tuple(self.tree(config, os.path.abspath(path)) for path in versions)
+        except ParseError as e:
+            raise DaemonError(str(e))
+        key = (config.differ,) + trees
+
+        # Trees are tagged with the diff result of a single merge at a time
+        if self.last is None or self.last[0] != key:
+            self.reset()
+            self.last = (key, config.diff(*trees), {})
+        _, tagged, results_by_analysis = self.last
+
+        report = StreamingAnalysisReport()
+        results = []
+        cached = True
+        for analysis_cls in analysis_classes:
+            if analysis_cls.key not in results_by_analysis:
+                cached = False
+                results_by_analysis[analysis_cls.key] = list(tagged.analyze(analysis_cls).analysis())
+            for result in results_by_analysis[analysis_cls.key]:
+                report.add(result)
+                results.append(result_as_dict(result))
+
+        return {
+            'results': results,
+            'metrics': [metric_as_dict(metric) for metric in report.get_metrics()],
+            'truncated': sorted(tagged.changes().truncated),
+            'cached': cached,
+        }
+
+    def status(self) -> Response:
+        """
+        :return: The response with the uptime, number of requests and the numbers of resident trees and diff results.
+        """
+        return {
+            'uptime': time.time() - self.started,
+            'requests': self.requests,
+            'trees': len(self.trees),
+            'diffs': len(self.diff_cache),
+        }
+
+    def handle(self, request: Request) -> Response:
+        """
+        Handles a request.
+
+        :param request: The request, of which the `command` is `analyze`, `status` or `shutdown`.
+        :return: The response, with the `error` key set if the request failed.
+        """
+        self.requests += 1
+        command = request.get('command')
+        start = time.perf_counter()
+
+        try:
+            if command == 'analyze':
+                response = self.analyze(request)
+            elif command == 'status':
+                response = self.status()
+            elif command == 'shutdown':
+                self._stopped = True
+                response = {}
+            else:
+                raise DaemonError(f"Unknown command '{command}'.")
+        except DaemonError as e:
+            response = {'error': str(e)}
+        except Exception as e:
+            # Keep serving with clean trees, as the failed request may have tagged them partially
+            self.last = None
+            for _, root in self.trees.values():
+                for node in root.flat.nodes:
+                    node.untag()
+            response = {'error': f"{e.__class__.__name__}: {e}"}
+
+        response['time'] = time.perf_counter() - start
+        return response
+
+    def serve(self) -> None:
+        """
+        Serves requests on the socket until a shutdown request is received.
+        """
+        if os.path.exists(self.path):
+            os.unlink(self.path)
+
+        daemon = self
+
+        class Handler(socketserver.StreamRequestHandler):
+            def handle(self):
+                for line in self.rfile:
+                    try:
+                        request = json.loads(line)
+                    except ValueError:
+                        response = {'error': "The request is not valid JSON."}
+                    else:
+                        response = daemon.handle(request)
+                    self.wfile.write(json.dumps(response).encode('utf-8') + b'\n')
+                    self.wfile.flush()
+
+        self._stopped = False
+        with socketserver.UnixStreamServer(self.path, Handler) as server:
+            try:
+                while not self._stopped:
+                    server.handle_request()
+            finally:
+                os.unlink(self.path)
+
+
+def default_socket() -> str:
+    """
+    :return: The default path of the socket of the daemon, which is unique per user.
+    """
+    return os.environ.get('CHECKMERGE_SOCKET') or os.path.join(tempfile.gettempdir(), f'checkmerge-{os.getuid()}.sock')
+
+
+def request(path: str, payload: Request, timeout: typing.Optional[float] = None) -> Response:
+    """
+    Sends a request to a daemon.
+
+    :param path: The path of the socket of the daemon.
+    :param payload: The request.
+    :param timeout: The number of seconds to wait for the response, or `None` to wait indefinitely.
+    :return: The response.
+    """
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+        sock.settimeout(timeout)
+        sock.connect(path)
+        with sock.makefile('rwb') as f:
+            f.write(json.dumps(payload).encode('utf-8') + b'\n')
+            f.flush()
+            return json.loads(f.readline())
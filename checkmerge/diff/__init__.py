@@ -1,14 +1,17 @@
-from .base import Change, DiffAlgorithm, DiffChanges, DiffResult, EditOperation, MergeDiffResult, combine_mappings, \
-    tag_nodes
+from .base import Change, DiffAlgorithm, DiffBudget, DiffChanges, DiffMapping, DiffResult, EditOperation, \
+    MergeDiffResult, combine_mappings, tag_nodes, untag_nodes
 
 
 __all__ = [
     DiffAlgorithm,
+    DiffBudget,
     DiffResult,
     MergeDiffResult,
     DiffChanges,
+    DiffMapping,
     Change,
     EditOperation,
     combine_mappings,
     tag_nodes,
+    untag_nodes,
 ]
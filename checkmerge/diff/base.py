@@ -1,10 +1,12 @@
 import enum
 import os
+import time
 import typing
 
 import itertools
 
 from checkmerge.ir import tree
+from checkmerge.util.trace import tracer
 
 
 # Diff algorithm types
@@ -17,6 +19,12 @@ class DiffAlgorithm(object):
     """
     Base class for diff algorithms.
     """
+    key: str = ''
+    name: str = ''
+    description: str = ''
+
+    #: Whether the algorithm accepts the `time_budget` and `work_budget` options (see `DiffBudget`).
+    budgeted: bool = False
 
     def __call__(self, base: tree.Node, other: tree.Node, mapping: typing.Optional[DiffMapping] = None) -> "DiffResult":
         """
@@ -29,10 +37,79 @@ class DiffAlgorithm(object):
         """
         raise NotImplementedError()
 
+    def merge(self, ancestor: tree.Node, base: tree.Node, other: tree.Node) -> "MergeDiffResult":
+        """
+        Diffs the versions of a merge. Both versions are diffed against their common ancestor, after which the versions
+        are diffed against each other, starting off with the mapping through the ancestor, to map the nodes that are
+        not mapped through the ancestor. Diff algorithms can override this to share work between the diffs.
+
+        :param ancestor: The common ancestor tree.
+        :param base: The base tree.
+        :param other: The other tree.
+        :return: The combined diff result.
+        """
+        with tracer.span('diff', versions='ancestor/base'):
+            base_result = self(ancestor, base)
+        with tracer.span('diff', versions='ancestor/other'):
+            other_result = self(ancestor, other)
+
+        mapping = combine_mappings(base_result.mapping, other_result.mapping)
+        with tracer.span('diff', versions='base/other'):
+            two_way_result = self(base, other, mapping)
+
+        return MergeDiffResult(base, other, ancestor, base_result, other_result, two_way_result)
+
     def __repr__(self):
         return f"<{self.__class__.__name__}>"
 
 
+class DiffBudget(object):
+    """
+    Budget of a diff in wall-clock time and in work, for diff algorithms with phases that can be cut short. The phases
+    that ran out of budget are recorded as truncated, which is reported on the diff result (see `DiffResult`).
+
+    Work is counted in nodes, by the diff algorithm. The time includes the phases that always run to completion, so the
+    remaining phases get the time that is left.
+    """
+    __slots__ = ('deadline', 'work', 'spent', 'truncated')
+
+    def __init__(self, seconds: typing.Optional[float] = None, work: typing.Optional[int] = None):
+        """
+        :param seconds: The number of seconds the diff may take from now, or `None` for no time limit.
+        :param work: The amount of work the diff may do, or `None` for no work limit.
+        """
+        self.deadline: typing.Optional[float] = None if seconds is None else time.perf_counter() + seconds
+        self.work: typing.Optional[int] = work
+        self.spent: int = 0
+        self.truncated: typing.Set[str] = set()
+
+    @property
+    def exhausted(self) -> bool:
+        """Whether the budget has been used up."""
+        return (self.work is not None and self.spent >= self.work) or \
+            (self.deadline is not None and time.perf_counter() >= self.deadline)
+
+    def take(self, work: int) -> bool:
+        """
+        Spends the given amount of work if it fits in the remaining budget.
+
+        :param work: The amount of work.
+        :return: Whether the work has been spent and may be done.
+        """
+        if self.exhausted or (self.work is not None and self.spent + work > self.work):
+            return False
+        self.spent += work
+        return True
+
+    def truncate(self, phase: str) -> None:
+        """
+        Records that a phase has been cut short.
+
+        :param phase: The name of the phase.
+        """
+        self.truncated.add(phase)
+
+
 class EditOperation(enum.Enum):
     """
     Kinds of operations for transforming a tree.
@@ -91,20 +168,38 @@ class Change(object):
         return f"({', '.join(parts)})"
 
 
+# Change codes of the edit operations, see `DiffResult`
+_codes_by_operation: typing.Dict[EditOperation, int] = {op: ord(op.value) for op in EditOperation}
+_operations_by_code: typing.Dict[int, EditOperation] = {code: op for op, code in _codes_by_operation.items()}
+_insert_code = _codes_by_operation[EditOperation.INSERT]
+_rename_code = _codes_by_operation[EditOperation.RENAME]
+
+
 class DiffResult(object):
     """
     Result of a tree diff operation.
+
+    The changes, the lookup of changes by node and the change codes of the nodes are built together in a single walk of
+    each tree on first use. The change code of a node is the value of its edit operation, or zero if it is unchanged,
+    and is stored in a byte array per tree indexed by the preorder index of the node (see `ir.FlatTree`).
+
+    A diff that ran out of budget (see `DiffBudget`) marks its result with the truncated phases, in which case the
+    mapping is approximate.
     """
-    __slots__ = ('_base', '_other', '_mapping', '_changes', '_reduced_changes', '_changes_by_node')
+    __slots__ = ('_base', '_other', '_mapping', '_reverse_mapping', '_changes', '_reduced_changes',
+                 '_changes_by_node', '_change_codes', '_truncated')
 
     def __init__(self, base: tree.Node, other: tree.Node, mapping: DiffMapping,
-                 changes: typing.Optional[DiffChanges] = None):
+                 changes: typing.Optional[DiffChanges] = None, truncated: typing.Iterable[str] = ()):
+        self._truncated: typing.FrozenSet[str] = frozenset(truncated)
         self._base: tree.Node = base
         self._other: tree.Node = other
         self._mapping: DiffMapping = mapping
+        self._reverse_mapping: typing.Optional[DiffMapping] = None
         self._changes: typing.Optional[DiffChanges] = changes
         self._reduced_changes: typing.Optional[DiffChanges] = None
         self._changes_by_node: typing.Dict[tree.Node, Change] = None
+        self._change_codes: typing.Optional[typing.Tuple[bytearray, bytearray]] = None
 
     @property
     def base(self) -> tree.Node:
@@ -121,28 +216,115 @@ class DiffResult(object):
         """The mapping from nodes of the base tree to nodes of the other tree."""
         return self._mapping
 
+    @property
+    def truncated(self) -> typing.FrozenSet[str]:
+        """The phases of the diff that were cut short by its budget."""
+        return self._truncated
+
+    @property
+    def approximate(self) -> bool:
+        """Whether the mapping is approximate, as the diff ran out of budget."""
+        return bool(self._truncated)
+
+    @property
+    def reverse_mapping(self) -> DiffMapping:
+        """The mapping from nodes of the other tree to nodes of the base tree."""
+        if self._reverse_mapping is None:
+            self._reverse_mapping = {other: base for base, other in self.mapping.items()}
+        return self._reverse_mapping
+
     @property
     def changes(self) -> DiffChanges:
         """The changes extracted from nodes."""
         if self._changes is None:
-            self._changes = list(calculate_changes(self.base, self.other, self.mapping))
+            self._index()
         return self._changes
 
     @property
-    def changes_by_node(self):
+    def changes_by_node(self) -> typing.Dict[tree.Node, "Change"]:
         """Dictionary for looking up a change by a node."""
         if self._changes_by_node is None:
-            self._changes_by_node = {}
-            # Build lookup table for changes per node
-            for change in self.changes:
-                assert change.base not in self._changes_by_node or change in self._changes_by_node.values()
-                assert change.other not in self._changes_by_node or change in self._changes_by_node.values()
+            self._index()
+        return self._changes_by_node
+
+    @property
+    def change_codes(self) -> typing.Tuple[bytearray, bytearray]:
+        """The change codes of the nodes of the base tree and of the other tree, by preorder index from the root."""
+        if self._change_codes is None:
+            self._index()
+        return self._change_codes
+
+    def change_operation(self, node: tree.Node, other: bool = False) -> typing.Optional[EditOperation]:
+        """
+        :param node: A node of the base tree or the other tree.
+        :param other: Whether the node is looked up in the other tree instead of the base tree. The side is not derived
+                      from the node, as both trees are the same in a diff of a tree with itself.
+        :return: The edit operation of the change of the node, or `None` if the node is unchanged.
+        """
+        root = self.other if other else self.base
+        if node.flat is not root.flat or not 0 <= node.index - root.index < root.size:
+            raise ValueError(f"The node {node} is not part of the {'other' if other else 'base'} tree.")
+        codes = self.change_codes[1 if other else 0]
+        return _operations_by_code.get(codes[node.index - root.index])
+
+    def _index(self) -> None:
+        """
+        Builds the changes, the lookup of changes by node and the change codes. Only the subtrees rooted at the base
+        and the other tree are walked, and the change codes are indexed relative to their roots.
+        """
+        base, other = self.base, self.other
+        base_flat, other_flat = base.flat, other.flat
+        base_offset, other_offset = base.index, other.index
+        base_codes, other_codes = bytearray(base.size), bytearray(other.size)
+        by_node: typing.Dict[tree.Node, Change] = {}
 
+        def other_code(node: tree.Node, code: int) -> None:
+            k = node.index - other_offset
+            if node.flat is other_flat and 0 <= k < len(other_codes):
+                other_codes[k] = code
+
+        if self._changes is None:
+            changes = []
+            mapping, reverse_mapping = self.mapping, self.reverse_mapping
+
+            for i in base_flat.subtree(base_offset):
+                node = base_flat.nodes[i]
+                match = mapping.get(node)
+                if match is None:
+                    change = Change(node, None, EditOperation.DELETE)
+                elif node.name != match.name:
+                    change = Change(node, match, EditOperation.RENAME)
+                    other_code(match, _rename_code)
+                    by_node[match] = change
+                else:
+                    continue
+                base_codes[i - base_offset] = _codes_by_operation[change.op]
+                by_node[node] = change
+                changes.append(change)
+
+            for i in other_flat.subtree(other_offset):
+                node = other_flat.nodes[i]
+                if node not in reverse_mapping:
+                    change = Change(None, node, EditOperation.INSERT)
+                    other_codes[i - other_offset] = _insert_code
+                    by_node[node] = change
+                    changes.append(change)
+
+            self._changes = changes
+        else:
+            for change in self._changes:
+                code = _codes_by_operation[change.op]
                 if change.base is not None:
-                    self._changes_by_node[change.base] = change
+                    k = change.base.index - base_offset
+                    if change.base.flat is base_flat and 0 <= k < len(base_codes):
+                        base_codes[k] = code
+                    by_node[change.base] = change
                 if change.other is not None:
-                    self._changes_by_node[change.other] = change
-        return self._changes_by_node
+                    other_code(change.other, code)
+                    by_node[change.other] = change
+
+        self._changes_by_node = by_node
+        self._change_codes = (base_codes, other_codes)
 
     @property
     def change_count(self):
@@ -150,7 +332,7 @@ class DiffResult(object):
 
     @property
     def node_count(self):
-        return sum(1 for n in itertools.chain(self.base.nodes, self.other.nodes))
+        return self.base.size + self.other.size
 
 
 class MergeDiffResult(DiffResult):
@@ -164,12 +346,17 @@ class MergeDiffResult(DiffResult):
 
         # If there is a two-way diff result, add additional mappings if none of the nodes is already mapped
         if two_way_result is not None:
+            mapped = set(mapping.values())
             for base_node, other_node in two_way_result.mapping.items():
-                if base_node not in mapping.keys() and other_node not in mapping.values():
+                if base_node not in mapping and other_node not in mapped:
                     mapping[base_node] = other_node
+                    mapped.add(other_node)
 
-        # Super init
-        super(MergeDiffResult, self).__init__(base, other, mapping)
+        # Super init, the combined result is approximate if any of the diffs is
+        truncated = base_result.truncated | other_result.truncated
+        if two_way_result is not None:
+            truncated |= two_way_result.truncated
+        super(MergeDiffResult, self).__init__(base, other, mapping, truncated=truncated)
 
         # Set additional properties
         self._ancestor = ancestor
@@ -211,7 +398,7 @@ class MergeDiffResult(DiffResult):
 
     @property
     def node_count(self):
-        return sum(1 for n in itertools.chain(self._base_result.base.nodes, self.base.nodes, self.other.nodes))
+        return self._base_result.base.size + self.base.size + self.other.size
 
 
 def combine_mappings(base_mapping: DiffMapping, other_mapping: DiffMapping) -> DiffMapping:
@@ -225,10 +412,9 @@ def combine_mappings(base_mapping: DiffMapping, other_mapping: DiffMapping) -> D
     :param other_mapping: Mapping from a common ancestor to the other version.
     :return: Mapping from the base version to the other version.
     """
-    mapping = {}
-    for key in set(base_mapping.keys()).intersection(set(other_mapping.keys())):
-        mapping[base_mapping[key]] = other_mapping[key]
-    return mapping
+    if len(other_mapping) < len(base_mapping):
+        return {base_mapping[key]: value for key, value in other_mapping.items() if key in base_mapping}
+    return {value: other_mapping[key] for key, value in base_mapping.items() if key in other_mapping}
 
 
 def calculate_changes(base: tree.Node, other: tree.Node, mapping: DiffMapping) -> ChangesGenerator:
@@ -241,12 +427,14 @@ def calculate_changes(base: tree.Node, other: tree.Node, mapping: DiffMapping) -
     :return: Generator yielding the changes between the base tree and other tree.
     """
     for node in base.subtree():
-        if node not in mapping.keys():
+        match = mapping.get(node)
+        if match is None:
             yield Change(node, None, EditOperation.DELETE)
-        elif node.name != mapping[node].name:
-            yield Change(node, mapping[node], EditOperation.RENAME)
+        elif node.name != match.name:
+            yield Change(node, match, EditOperation.RENAME)
+    mapped = set(mapping.values())
     for node in other.subtree():
-        if node not in mapping.values():
+        if node not in mapped:
             yield Change(None, node, EditOperation.INSERT)
 
 
@@ -282,3 +470,11 @@ def tag_nodes(result: DiffResult) -> None:
             base.is_changed = True
         if other is not None:
             other.is_changed = True
+
+
+def untag_nodes(result: DiffResult) -> None:
+    """
+    Removes the change information added to the IR nodes by `tag_nodes()`.
+    """
+    for node in itertools.chain(result.base.flat.nodes, result.other.flat.nodes):
+        node.untag()
@@ -1,13 +1,13 @@
-import itertools
 import typing
 
 import bidict
-import pylev3
-import zss
 
-from checkmerge.diff.base import DiffAlgorithm, DiffMapping, DiffResult
+from checkmerge import plugin
+from checkmerge.diff import ted
+from checkmerge.diff.base import DiffAlgorithm, DiffBudget, DiffMapping, DiffResult
 from checkmerge.ir import tree
-from checkmerge.util.collections import PriorityList, exists
+from checkmerge.util.collections import PriorityList
+from checkmerge.util.trace import tracer
 
 
 class GumTreeDiff(DiffAlgorithm):
@@ -18,11 +18,20 @@ class GumTreeDiff(DiffAlgorithm):
     The `opt()` part of the algorithm is different from the algorithm used by the original authors so an existing Python
     implementation of an algorithm for the same purpose could be used.
 
+    With a time or work budget the diff is an anytime algorithm. The hash driven top down phase always runs to
+    completion, after which the bottom up phase visits the remaining nodes, subtrees before their ancestors, until the
+    budget is used up. The edit distances of `opt()` are only computed while their work, the product of the sizes of
+    both subtrees, fits in the remaining budget, so the budget goes to the smaller subtrees first. The phases that were
+    cut short are reported on the diff result (see `DiffResult.truncated`).
+
     [1]: Falleri et al. Fine-grained and Accurate Source Code Differencing. 2014.
     [2]: https://github.com/GumTreeDiff/gumtree
     """
+    key, name, description = plugin.GUMTREE_DIFF
+    budgeted = True
 
-    def __init__(self, min_height: int = 2, min_dice: float = 0.3, max_size: int = 100):
+    def __init__(self, min_height: int = 2, min_dice: float = 0.3, max_size: int = 100,
+                 time_budget: typing.Optional[float] = None, work_budget: typing.Optional[int] = None):
         """
         Instantiates a new tree diff executor with the given configuration parameters. The default values have been
         taken from the Java implementation of the same algorithm.
@@ -30,12 +39,24 @@ class GumTreeDiff(DiffAlgorithm):
         :param min_height: The minimum height of matched subtrees.
         :param min_dice: The minimum dice coefficient when nodes with non-matching subtrees can still be matched.
         :param max_size: The maximum size of a subtree to compute an edit script for.
+        :param time_budget: The number of seconds a diff may take, or `None` for no time limit.
+        :param work_budget: The work the bottom up phase may do, counted in nodes, or `None` for no work limit.
         """
         super(GumTreeDiff, self).__init__()
 
         self.min_height = min_height
         self.min_dice = min_dice
         self.max_size = max_size
+        self.time_budget = time_budget
+        self.work_budget = work_budget
+
+    def budget(self) -> typing.Optional[DiffBudget]:
+        """
+        :return: A new budget for a diff, or `None` if the diff is not limited.
+        """
+        if self.time_budget is None and self.work_budget is None:
+            return None
+        return DiffBudget(self.time_budget, self.work_budget)
 
     def __call__(self, base: tree.Node, other: tree.Node, mapping: typing.Optional[DiffMapping] = None) -> DiffResult:
         """
@@ -46,9 +67,12 @@ class GumTreeDiff(DiffAlgorithm):
         :param mapping: A mapping from nodes of the base tree to nodes of the other tree to start off with.
         :return: A mapping between nodes from the base tree to nodes from the other tree.
         """
-        mapping = self.top_down(base, other)
-        mapping = self.bottom_up(base, other, mapping)
-        return DiffResult(base, other, mapping)
+        budget = self.budget()
+        with tracer.span('gumtree.top_down'):
+            mapping = self.top_down(base, other)
+        with tracer.span('gumtree.bottom_up'):
+            mapping = self.bottom_up(base, other, mapping, budget)
+        return DiffResult(base, other, mapping, truncated=budget.truncated if budget is not None else ())
 
     def top_down(self, base: tree.Node, other: tree.Node, mapping: typing.Optional[DiffMapping] = None) -> DiffMapping:
         """
@@ -65,8 +89,10 @@ class GumTreeDiff(DiffAlgorithm):
         l1 = PriorityList(key=self.priority)
         l2 = PriorityList(key=self.priority)
 
-        # Candidate mappings
+        # Candidate mappings, with the nodes of both sides for membership tests
         a: typing.List[typing.Tuple[tree.Node, tree.Node]] = []
+        a1: typing.Set[tree.Node] = set()
+        a2: typing.Set[tree.Node] = set()
 
         # Decided on mappings
         m = bidict.bidict()
@@ -76,6 +102,10 @@ class GumTreeDiff(DiffAlgorithm):
             for k, v in mapping.items():
                 m[k] = v
 
+        # Index the subtrees of both trees by hash to look up isomorphic subtrees
+        base_index = self.hash_index(base.subtree())
+        other_index = self.hash_index(other.subtree())
+
         # Start with the root nodes
         l1.push(base)  # line 1
         l2.push(other)  # line 2
@@ -94,13 +124,17 @@ class GumTreeDiff(DiffAlgorithm):
                 h1 = l1.pop_many()  # line 10
                 h2 = l2.pop_many()  # line 11
 
-                # Iterate over isomorphic pairs of subtrees
-                for t1, t2 in filter(lambda x: self.isomorphic(*x), itertools.product(h1, h2)):  # line 12, 13
+                # Iterate over isomorphic pairs of subtrees, in the same order as the product of both lists
+                h2_index = self.hash_index(h2)
+                if tracer.enabled:
+                    tracer.count('gumtree.isomorphic', sum(len(h2_index.get(t1.hash, ())) for t1 in h1))
+                for t1, t2 in ((t1, t2) for t1 in h1 for t2 in h2_index.get(t1.hash, ())):  # line 12, 13
                     # If there are multiple candidates for a subtree, add these to the candidate set
                     # Otherwise add the subtrees and their children to the mappings.
-                    if exists(other.subtree(), lambda tx: self.isomorphic(t1, tx) and tx != t2) or \
-                            exists(base.subtree(), lambda tx: self.isomorphic(tx, t2) and tx != t1):  # Line 14
+                    if len(other_index[t1.hash]) > 1 or len(base_index[t2.hash]) > 1:  # Line 14
                         a.append((t1, t2))  # line 15
+                        a1.add(t1)
+                        a2.add(t2)
                     else:
                         # Because the trees are isomorphic walking them in the same order results in the correct
                         # mapping between the nodes
@@ -109,26 +143,31 @@ class GumTreeDiff(DiffAlgorithm):
 
                 # Add the unmapped subtrees to the queue
                 for t in h1:  # line 18
-                    if t not in map(lambda x: x[0], a) and t not in m:  # line 18
+                    if t not in a1 and t not in m:  # line 18
                         l1.open(t.children)  # line 18
 
                 # Add the unmapped subtrees to the queue
                 for t in h2:  # line 18
-                    if t not in map(lambda x: x[1], a) and t not in m.inv:  # line 18
+                    if t not in a2 and t not in m.inv:  # line 18
                         l2.open(t.children)  # line 18
 
-        # Sort the candidate mappings on their dice coefficient
-        a.sort(key=lambda x: self.dice(x[0].parent, x[1].parent, m), reverse=True)  # line 19
+        # Sort the candidate mappings on the dice coefficient of their parents, which is zero for roots
+        a.sort(key=lambda x: self.dice(x[0].parent, x[1].parent, m)
+               if x[0].parent is not None and x[1].parent is not None else 0.0, reverse=True)  # line 19
 
         # Add candidates in order to the mapping if the nodes are not mapped to ensure the best options are chosen
         for t1, t2 in a:  # line 20, 21
             if t1 not in m and t2 not in m.inv:  # line 23, 24
-                for n1, n2 in filter(lambda x: self.isomorphic(*x) and x[0] not in m and x[1] not in m.inv, itertools.product(t1.subtree(), t2.subtree())):
-                    m[n1] = n2  # line 22
+                t2_index = self.hash_index(t2.subtree())
+                for n1 in t1.subtree():
+                    for n2 in t2_index.get(n1.hash, ()):
+                        if n1 not in m and n2 not in m.inv:
+                            m[n1] = n2  # line 22
 
         return m
 
-    def bottom_up(self, base: tree.Node, other: tree.Node, m: DiffMapping) -> DiffMapping:
+    def bottom_up(self, base: tree.Node, other: tree.Node, m: DiffMapping,
+                  budget: typing.Optional[DiffBudget] = None) -> DiffMapping:
         """
         Runs the GumTree bottom up algorithm on the given trees. Expects a mapping from the top down phase as input.
 
@@ -140,15 +179,33 @@ class GumTreeDiff(DiffAlgorithm):
         :param other: The tree to compare.
         :param m: A mapping between nodes from the base tree to nodes from the other tree. This is typically produced by
                   the top down phase algorithm.
+        :param budget: The budget of the diff, in which the cut short phases are recorded.
         :return: A mapping between nodes from the base tree to nodes from the other tree.
         """
+        # Position of the nodes of the other tree in a bottom-up walk, candidates are evaluated in this order
+        other_order = {n: i for i, n in enumerate(other.subtree(reverse=True))}
+
+        # Mapped nodes of the other tree for constant time lookups
+        mapped = set(m.values())
+
         # Iterate over unmatched nodes
         for t1 in filter(lambda x: x not in m, base.subtree(reverse=True)):  # line 1
             # Do steps if a child is matched
             if [c for c in t1.children if c in m]:
+                # Stop once the budget is used up, the remaining nodes stay unmatched
+                if budget is not None and not budget.take(t1.size):
+                    budget.truncate('bottom_up')
+                    break
+
+                # Only the containers of the nodes mapped to descendants of t1 have a positive dice coefficient, those
+                # above the other tree are left out when diffing subtrees
+                candidates = sorted(filter(other_order.__contains__, self.container_candidates(t1, m)),
+                                    key=other_order.__getitem__)
+
                 # Select similar nodes based on dice coefficient
-                t2s = filter(lambda y: y[1] not in m.values() and y[0] > self.min_dice and t1.type == y[1].type,
-                             ((self.dice(t1, tx, m), tx) for tx in other.subtree(reverse=True)))  # line 2, 3
+                t2s = filter(lambda y: y[0] > self.min_dice,
+                             ((self.dice(t1, tx, m), tx) for tx in candidates
+                              if tx not in mapped and t1.type == tx.type))  # line 2, 3
 
                 # Choose best match
                 t2 = max(t2s, default=(None, None))[1]  # line 2, 3
@@ -156,39 +213,81 @@ class GumTreeDiff(DiffAlgorithm):
                 # Store best match as mapping
                 if t2 is not None:  # line 3
                     m[t1] = t2  # line 4
+                    mapped.add(t2)
 
-                    t1l = len(list(t1.subtree(include_self=False)))  # line 5
-                    t2l = len(list(t2.subtree(include_self=False)))  # line 5
+                    t1l = t1.size - 1  # line 5
+                    t2l = t2.size - 1  # line 5
 
                     # Ensure we only do the following computation for suitably small trees
-                    if max(t1l, t2l) < self.max_size:  # line 5
+                    if max(t1l, t2l) < self.max_size and self._take_opt(budget, t1.size * t2.size):  # line 5
+                        # No more nodes can be matched if either subtree is matched completely
+                        if all(n in m for n in t1.subtree()) or all(n in mapped for n in t2.subtree()):
+                            tracer.count('gumtree.opt_skipped')
+                            continue
+
                         # Try to match even more nodes based on their edit distance
                         pairs = filter(lambda x: x[0] is not None and x[1] is not None, self.opt(t1, t2))  # line 6
                         for r1, r2 in pairs:  # line 7
-                            if r1 not in m.keys() and r2 not in m.values() and r1.type == r2.type:  # line 8
+                            if r1 not in m.keys() and r2 not in mapped and r1.type == r2.type:  # line 8
                                 m[r1] = r2  # line 9
+                                mapped.add(r2)
 
         return m
 
+    @staticmethod
+    def _take_opt(budget: typing.Optional[DiffBudget], work: int) -> bool:
+        """Spends the work of an `opt()` call on the budget, or records that `opt()` has been skipped."""
+        if budget is None or budget.take(work):
+            return True
+        budget.truncate('opt')
+        return False
+
+    @staticmethod
+    def container_candidates(t: tree.Node, m: DiffMapping) -> typing.Set[tree.Node]:
+        """
+        Collects the candidates for matching a node in the bottom up phase. These are the ancestors of the nodes that
+        the descendants of the given node are mapped to. Other nodes have no descendants in common with the given node.
+
+        :param t: The node to find candidates for.
+        :param m: The mappings between nodes of both trees.
+        :return: The candidate nodes from the other tree.
+        """
+        candidates = set()
+        for d in t.descendants:
+            candidate = m.get(d)
+            candidate = candidate.parent if candidate is not None else None
+            # Stop at an ancestor that has been added already, as its ancestors have been added as well
+            while candidate is not None and candidate not in candidates:
+                candidates.add(candidate)
+                candidate = candidate.parent
+        return candidates
+
     def opt(self, base: tree.Node, other: tree.Node) -> typing.List[typing.Tuple[tree.Node, tree.Node]]:
         """
         Runs the GumTree optimization algorithm on the given trees.
 
         The optimization algorithm tries to find mappings between nodes based on the edit distance.
-
-        The Zhang-Shasha algorithm is used to calculate the edit distance with the Wagner-Fischer algorithm for the
-        labels.
+        The Zhang-Shasha algorithm is used to calculate the edit distance with the bit-parallel Levenshtein distance for
+        the labels. A single distance computation for both trees yields the distances between all pairs of their
+        subtrees.
         """
-        candidates = {}
-
-        for t1, t2 in itertools.product(base.subtree(), other.subtree()):
-            distance = zss.simple_distance(t1, t2, get_children=lambda n: n.children, get_label=lambda n: n.name,
-                                           label_dist=pylev3.Levenshtein.wfi)
+        with tracer.span('gumtree.opt'):
+            distance = ted.TreeEditDistance(base, other, get_label=lambda n: n.name)
+            return distance.closest_subtrees()
 
-            if t1 not in candidates or candidates[t1][0] > distance:
-                candidates[t1] = (distance, t2)
+    @staticmethod
+    def hash_index(nodes: typing.Iterable[tree.Node]) -> typing.Dict[bytes, typing.List[tree.Node]]:
+        """
+        Builds an index of the given nodes by the hash of their subtree. Isomorphic subtrees share a bucket, in which
+        the nodes keep the order of the given iterable.
 
-        return [(n, t[1]) for n, t in candidates.items()]
+        :param nodes: The nodes to index.
+        :return: A mapping from subtree hashes to the nodes with that hash.
+        """
+        index = {}
+        for node in nodes:
+            index.setdefault(node.hash, []).append(node)
+        return index
 
     @staticmethod
     def priority(t: tree.Node) -> int:
@@ -213,25 +312,44 @@ class GumTreeDiff(DiffAlgorithm):
         :param mappings: The mappings between nodes of t1 (keys) and t2 (values).
         :return: The dice coefficient given the two subtrees and the mappings.
         """
-        d1 = set(t1.descendants)
-        d2 = set(t2.descendants)
-        common = len({d for d in d1 if mappings.get(d) in d2})
-        return float(2 * common) / float(len(d1) + len(d2))
+        tracer.count('gumtree.dice')
+        common = GumTreeDiff.common_descendants(t1, t2, mappings)
+        return float(2 * common) / float(t1.size - 1 + t2.size - 1)
 
     @staticmethod
     def jaccard(t1: tree.Node, t2: tree.Node, mappings: typing.Dict[tree.Node, tree.Node]) -> float:
-        d1 = set(t1.descendants)
-        d2 = set(t2.descendants)
-        common = len({d for d in d1 if mappings.get(d) in d2})
+        common = GumTreeDiff.common_descendants(t1, t2, mappings)
         try:
-            return float(common) / float(len(d1) + len(d2) - common)
+            return float(common) / float(t1.size - 1 + t2.size - 1 - common)
         except ZeroDivisionError:
             return 1.0
 
+    @staticmethod
+    def common_descendants(t1: tree.Node, t2: tree.Node, mappings: typing.Dict[tree.Node, tree.Node]) -> int:
+        """
+        Counts the descendants of the first node that are mapped to descendants of the second node. The descendants of
+        the second node form an interval in a top-down walk of its tree (see `FlatTree`), so membership is a range
+        check on the index of the mapped node.
+
+        :param t1: The first node.
+        :param t2: The second node.
+        :param mappings: The mappings between nodes of t1 (keys) and t2 (values).
+        :return: The number of common descendants.
+        """
+        flat, start = t2.flat, t2.index
+        end = start + t2.size
+        common = 0
+        for d in t1.descendants:
+            mapped = mappings.get(d)
+            if mapped is not None and start < mapped.index < end and mapped.flat is flat:
+                common += 1
+        return common
+
     @staticmethod
     def isomorphic(t1: tree.Node, t2: tree.Node) -> bool:
         """
-        Returns whether two subtrees identified by nodes are isomorphic with respect to the GumTree algorithm.
+        Returns whether two subtrees identified by nodes are isomorphic with respect to the GumTree algorithm. Only the
+        fixed-width subtree hashes are compared.
 
         :param t1: The first subtree.
         :param t2: The second subtree.
@@ -0,0 +1,168 @@
+import time
+import typing
+from concurrent.futures import ProcessPoolExecutor
+
+import bidict
+
+from checkmerge import plugin
+from checkmerge.diff.base import DiffAlgorithm, DiffMapping, DiffResult
+from checkmerge.diff.gumtree import GumTreeDiff
+from checkmerge.ir import serialize, tree
+from checkmerge.util.trace import tracer
+
+
+# Type definitions
+Shard = typing.Tuple[tree.Node, tree.Node]
+
+
+class ShardedDiff(DiffAlgorithm):
+    """
+    Tree diff that splits the trees into shards of top-level declarations, so the cost of a diff scales with the size
+    of the change instead of the size of the file.
+
+    Top-level declarations are paired across the trees by their reference, which is the USR for trees parsed by Clang.
+    Declarations without a unique reference are paired if their subtrees are identical and unique in both trees. Pairs
+    with identical subtrees are mapped node by node, the other pairs are diffed independently by the diff engine,
+    optionally in parallel worker processes. Declarations that are unpaired in both trees may have been renamed, in
+    which case the declarations cannot be told apart by their reference and the whole trees are diffed instead. Moved
+    declarations keep their reference and are paired regardless of their position.
+
+    Like `GumTreeDiff`, an initial mapping passed to the diff is not used.
+
+    A budget is passed on to the diff engine. The time budget is shared by the shards, each of which is diffed with the
+    time that is left, while the work budget applies to every shard. The result is approximate if any of the shards is.
+    """
+    key, name, description = plugin.SHARDED_DIFF
+    budgeted = True
+
+    def __init__(self, engine: typing.Type[DiffAlgorithm] = GumTreeDiff, workers: typing.Optional[int] = None,
+                 min_parallel_size: int = 2000, time_budget: typing.Optional[float] = None,
+                 work_budget: typing.Optional[int] = None):
+        """
+        :param engine: The diff algorithm for the shards and the whole tree fallback.
+        :param workers: The number of worker processes for diffing shards, or `None` to diff them in this process.
+        :param min_parallel_size: The minimum total number of nodes of the changed shards to diff them in parallel, as
+                                  smaller shards are diffed faster than they are sent to the workers.
+        :param time_budget: The number of seconds a diff may take, or `None` for no time limit.
+        :param work_budget: The work the diff of every shard may do (see `GumTreeDiff`), or `None` for no work limit.
+        """
+        super(ShardedDiff, self).__init__()
+        if (time_budget is not None or work_budget is not None) and not engine.budgeted:
+            raise ValueError(f"The diff engine {engine.key} does not support a budget.")
+        self.engine = engine
+        self.workers = workers
+        self.min_parallel_size = min_parallel_size
+        self.time_budget = time_budget
+        self.work_budget = work_budget
+
+    def __call__(self, base: tree.Node, other: tree.Node, mapping: typing.Optional[DiffMapping] = None) -> DiffResult:
+        deadline = None if self.time_budget is None else time.perf_counter() + self.time_budget
+        shards = self.pair(base, other)
+
+        if shards is None or base.type != other.type:
+            tracer.count('sharded.fallback')
+            return self.engine(**self.engine_options(deadline))(base, other)
+
+        result: DiffMapping = bidict.bidict({base: other})
+        changed: typing.List[Shard] = []
+        for b, o in shards:
+            if b.hash == o.hash:
+                # Identical subtrees have identical preorder walks
+                result.update(zip(b.flat.nodes[b.index:b.index + b.size], o.flat.nodes[o.index:o.index + o.size]))
+            else:
+                changed.append((b, o))
+
+        tracer.count('sharded.identical', len(shards) - len(changed))
+        tracer.count('sharded.changed', len(changed))
+
+        truncated: typing.Set[str] = set()
+        for shard_mapping, shard_truncated in self.diff_shards(changed, deadline):
+            result.update(shard_mapping)
+            truncated.update(shard_truncated)
+
+        return DiffResult(base, other, result, truncated=truncated)
+
+    def engine_options(self, deadline: typing.Optional[float] = None) -> typing.Dict[str, typing.Any]:
+        """
+        :param deadline: The time at which the time budget of the diff runs out, on the `time.perf_counter()` clock.
+        :return: The keyword arguments for constructing the diff engine, with the time that is left until the deadline.
+        """
+        options = {}
+        if deadline is not None:
+            options['time_budget'] = max(0.0, deadline - time.perf_counter())
+        if self.work_budget is not None:
+            options['work_budget'] = self.work_budget
+        return options
+
+    @staticmethod
+    def pair(base: tree.Node, other: tree.Node) -> typing.Optional[typing.List[Shard]]:
+        """
+        Pairs the top-level declarations of both trees.
+
+        :param base: The base tree.
+        :param other: The tree to compare.
+        :return: The pairs of declarations, or `None` if some declarations are unpaired in both trees.
+        """
+        def unique(nodes: typing.Iterable[tree.Node], key: typing.Callable[[tree.Node], typing.Any]) \
+                -> typing.Dict[typing.Any, tree.Node]:
+            by_key: typing.Dict[typing.Any, typing.Optional[tree.Node]] = {}
+            for node in nodes:
+                k = key(node)
+                if k:
+                    by_key[k] = None if k in by_key else node
+            return {k: node for k, node in by_key.items() if node is not None}
+
+        shards: typing.List[Shard] = []
+        unpaired = [list(base.children), list(other.children)]
+
+        # Pair by reference first and by identical subtree for the remaining declarations
+        for key in (lambda n: n.ref, lambda n: n.hash):
+            base_keys, other_keys = unique(unpaired[0], key), unique(unpaired[1], key)
+            paired = set()
+            for k, node in base_keys.items():
+                match = other_keys.get(k)
+                if match is not None:
+                    shards.append((node, match))
+                    paired.update((node, match))
+            unpaired = [[n for n in nodes if n not in paired] for nodes in unpaired]
+
+        if unpaired[0] and unpaired[1]:
+            return None
+        return shards
+
+    def diff_shards(self, shards: typing.List[Shard], deadline: typing.Optional[float] = None) \
+            -> typing.Iterable[typing.Tuple[DiffMapping, typing.FrozenSet[str]]]:
+        """
+        Diffs the given pairs of declarations.
+
+        :param shards: The pairs of declarations to diff.
+        :param deadline: The time at which the time budget runs out, see `engine_options()`.
+        :return: The mappings of the pairs, with the phases the budget cut short.
+        """
+        if self.workers is None or len(shards) < 2 or sum(b.size + o.size for b, o in shards) < self.min_parallel_size:
+            for b, o in shards:
+                with tracer.span('sharded.shard', ref=b.ref):
+                    shard_result = self.engine(**self.engine_options(deadline))(b, o)
+                    yield shard_result.mapping, shard_result.truncated
+            return
+
+        # Shards diffed in parallel share the time that is left when they are sent to the workers
+        blobs = [(serialize.dumps([b]), serialize.dumps([o])) for b, o in shards]
+        options = [self.engine_options(deadline)] * len(shards)
+        with ProcessPoolExecutor(max_workers=self.workers) as executor:
+            results = executor.map(_shard_worker, [self.engine] * len(shards), options, *zip(*blobs))
+            for (b, o), (base_indices, other_indices, truncated) in zip(shards, results):
+                yield zip((b.flat.nodes[b.index + i] for i in base_indices),
+                          (o.flat.nodes[o.index + i] for i in other_indices)), truncated
+
+
+def _shard_worker(engine: typing.Type[DiffAlgorithm], engine_options: typing.Dict[str, typing.Any], base_blob: bytes,
+                  other_blob: bytes) -> typing.Tuple[typing.List[int], typing.List[int], typing.FrozenSet[str]]:
+    """
+    Worker process function for diffing a shard. The mapping is returned as the indices of the mapped nodes in a
+    top-down walk of the declarations, together with the phases the budget cut short.
+    """
+    base, other = serialize.loads(base_blob)[0], serialize.loads(other_blob)[0]
+    result = engine(**engine_options)(base, other)
+    mapping = result.mapping
+    return [n.index for n in mapping.keys()], [n.index for n in mapping.values()], result.truncated
@@ -0,0 +1,135 @@
+import typing
+
+from checkmerge.ir import tree
+from checkmerge.util import levenshtein
+from checkmerge.util.trace import tracer
+
+
+# Type aliases
+LabelFunction = typing.Callable[[tree.Node], str]
+LabelDistance = typing.Callable[[str, str], int]
+
+
+class TreeEditDistance(object):
+    """
+    Tree edit distance between two trees using the Zhang-Shasha algorithm [1]. A single computation for a pair of trees
+    yields the edit distances between all pairs of their subtrees, from which the closest subtrees are selected.
+
+    Nodes are numbered in a bottom-up depth-first (postorder) walk starting at 1. The subtree of a node then spans the
+    numbers from its leftmost leaf descendant up to and including the node itself.
+
+    Labels are interned per tree, and the distances between the distinct labels of both trees are computed once up
+    front, as the algorithm compares the same pairs of labels many times. By default the Levenshtein distance is
+    computed for each distinct label of the base tree against all distinct labels of the other tree at once (see
+    `levenshtein.distances()`).
+
+    [1]: Zhang and Shasha. Simple Fast Algorithms for the Editing Distance between Trees and Related Problems. 1989.
+    """
+    def __init__(self, base: tree.Node, other: tree.Node, get_label: LabelFunction = lambda n: n.name,
+                 label_dist: typing.Optional[LabelDistance] = None):
+        """
+        :param base: The base tree.
+        :param other: The tree to compare.
+        :param get_label: Function returning the label of a node that is compared.
+        :param label_dist: Function returning the cost of changing one label into another, defaults to the Levenshtein
+                           distance. Inserting and removing a node costs the distance between its label and the empty
+                           label.
+        """
+        self.label_dist = label_dist if label_dist is not None else levenshtein.distance
+
+        self.nodes1, self.lld1, self.labels1 = self._index(base, get_label)
+        self.nodes2, self.lld2, self.labels2 = self._index(other, get_label)
+        self.remove_costs = [0] + [self.label_dist(label, '') for label in self.labels1[1:]]
+        self.insert_costs = [0] + [self.label_dist('', label) for label in self.labels2[1:]]
+
+        # Distances between the distinct labels of both trees
+        self.label_ids1, distinct1 = self._intern(self.labels1)
+        self.label_ids2, distinct2 = self._intern(self.labels2)
+        if label_dist is None:
+            self.label_costs = [levenshtein.distances(a, distinct2) for a in distinct1]
+        else:
+            self.label_costs = [[label_dist(a, b) for b in distinct2] for a in distinct1]
+
+        n, m = len(self.nodes1), len(self.nodes2)
+        self.treedist = [[0] * m for _ in range(n)]
+        self.forestdist = [[0] * m for _ in range(n)]
+
+        keyroots1, keyroots2 = self._keyroots(self.lld1), self._keyroots(self.lld2)
+        for i in keyroots1:
+            for j in keyroots2:
+                self._forest_distance(i, j)
+
+        if tracer.enabled:
+            tracer.count('ted.calls')
+            tracer.count('ted.forest_distances', len(keyroots1) * len(keyroots2))
+
+    @staticmethod
+    def _index(root: tree.Node, get_label: LabelFunction) \
+            -> typing.Tuple[typing.List[typing.Optional[tree.Node]], typing.List[int], typing.List[str]]:
+        """Numbers the nodes of a tree in postorder and determines their leftmost leaf descendants and labels."""
+        nodes = [None] + list(root.subtree(reverse=True))
+        lld = [0] + [k - node.size + 1 for k, node in enumerate(nodes[1:], 1)]
+        labels = [''] + [get_label(node) for node in nodes[1:]]
+        return nodes, lld, labels
+
+    @staticmethod
+    def _intern(labels: typing.List[str]) -> typing.Tuple[typing.List[int], typing.List[str]]:
+        """Numbers the distinct labels of a tree, returning the number of the label of each node and the labels."""
+        ids: typing.Dict[str, int] = {}
+        return [ids.setdefault(label, len(ids)) for label in labels], list(ids)
+
+    @staticmethod
+    def _keyroots(lld: typing.List[int]) -> typing.List[int]:
+        """The key roots of a tree, which are the highest nodes for each leftmost leaf descendant."""
+        keyroots = {}
+        for k in range(1, len(lld)):
+            keyroots[lld[k]] = k
+        return sorted(keyroots.values())
+
+    def _update_cost(self, i: int, j: int) -> int:
+        return self.label_costs[self.label_ids1[i]][self.label_ids2[j]]
+
+    def _forest_distance(self, i: int, j: int) -> None:
+        """Fills the forest distance table for the subtrees rooted at i and j, and their subtree distances."""
+        lld1, lld2, fd, td = self.lld1, self.lld2, self.forestdist, self.treedist
+        l1, l2 = lld1[i], lld2[j]
+
+        fd[l1 - 1][l2 - 1] = 0
+        for di in range(l1, i + 1):
+            fd[di][l2 - 1] = fd[di - 1][l2 - 1] + self.remove_costs[di]
+        for dj in range(l2, j + 1):
+            fd[l1 - 1][dj] = fd[l1 - 1][dj - 1] + self.insert_costs[dj]
+
+        label_ids2, insert_costs = self.label_ids2, self.insert_costs
+        for di in range(l1, i + 1):
+            remove = self.remove_costs[di]
+            update_costs = self.label_costs[self.label_ids1[di]]
+            for dj in range(l2, j + 1):
+                cost = min(fd[di - 1][dj] + remove, fd[di][dj - 1] + insert_costs[dj])
+                if lld1[di] == l1 and lld2[dj] == l2:
+                    fd[di][dj] = min(cost, fd[di - 1][dj - 1] + update_costs[label_ids2[dj]])
+                    td[di][dj] = fd[di][dj]
+                else:
+                    fd[di][dj] = min(cost, fd[lld1[di] - 1][lld2[dj] - 1] + td[di][dj])
+
+    @property
+    def distance(self) -> int:
+        """The edit distance between both trees."""
+        return self.treedist[-1][-1]
+
+    def closest_subtrees(self) -> typing.List[typing.Tuple[tree.Node, tree.Node]]:
+        """
+        Finds for each node of the base tree the node of the other tree with the subtree with the smallest edit distance
+        to its subtree. Ties are resolved in favor of the first node in a top-down walk of the other tree.
+
+        :return: Pairs of nodes of the base tree in a top-down walk and their closest nodes of the other tree.
+        """
+        order2 = sorted(range(1, len(self.nodes2)), key=lambda k: self.nodes2[k].index)
+        pairs = []
+
+        for i in sorted(range(1, len(self.nodes1)), key=lambda k: self.nodes1[k].index):
+            row = self.treedist[i]
+            best = min(order2, key=row.__getitem__)
+            pairs.append((self.nodes1[i], self.nodes2[best]))
+
+        return pairs
@@ -0,0 +1,86 @@
+import unittest
+
+from checkmerge.diff.base import DiffResult, EditOperation, MergeDiffResult, calculate_changes, combine_mappings
+from checkmerge.diff.gumtree import GumTreeDiff
+from checkmerge.diff.tests import test_gumtree
+from checkmerge.ir.tree import Node
+
+
+class DiffResultTestCase(unittest.TestCase):
+    def setUp(self):
+        test_gumtree.OriginalGumTreeTestCase.setUp(self)
+        self.result = GumTreeDiff()(self.t1, self.t2)
+
+    def test_changes(self):
+        """Tests that the indexed changes are equal to the calculated changes."""
+        expected = list(calculate_changes(self.t1, self.t2, self.result.mapping))
+        self.assertEqual([c.as_tuple() for c in expected], [c.as_tuple() for c in self.result.changes])
+        self.assertTrue(self.result.changes)
+
+        for change in self.result.changes:
+            for node, other in ((change.base, False), (change.other, True)):
+                if node is not None:
+                    self.assertIs(change, self.result.changes_by_node[node])
+                    self.assertEqual(change.op, self.result.change_operation(node, other))
+
+        unchanged = [n for n in self.t1.subtree() if n not in self.result.changes_by_node]
+        self.assertTrue(unchanged)
+        self.assertTrue(all(self.result.change_operation(n) is None for n in unchanged))
+
+    def test_self_diff(self):
+        """Tests the lookup of change operations in a diff of a tree with itself, by the side of the node."""
+        result = DiffResult(self.t1, self.t1, {self.t1: self.t1})
+        node = self.t1[0]
+        self.assertEqual(EditOperation.DELETE, result.change_operation(node))
+        self.assertEqual(EditOperation.INSERT, result.change_operation(node, other=True))
+        self.assertIsNone(result.change_operation(self.t1, other=True))
+
+        with self.assertRaises(ValueError):
+            self.result.change_operation(self.t2[0])
+
+    def test_subtree(self):
+        """Tests that a diff of subtrees only reports changes within the subtrees."""
+        a = Node("R", children=[Node("F"), Node("S", children=[Node("X"), Node("Y", label="a")])])
+        b = Node("R", children=[Node("F"), Node("S", children=[Node("X"), Node("Y", label="b")])])
+        result = GumTreeDiff()(a[1], b[1])
+
+        expected = list(calculate_changes(a[1], b[1], result.mapping))
+        self.assertEqual([c.as_tuple() for c in expected], [c.as_tuple() for c in result.changes])
+        self.assertTrue(all(n not in result.changes_by_node for n in (a, a[0], b, b[0])))
+        self.assertEqual((3, 3), tuple(len(codes) for codes in result.change_codes))
+        self.assertEqual(6, result.node_count)
+
+        for change in result.changes:
+            if change.base is not None:
+                self.assertEqual(change.op, result.change_operation(change.base))
+        with self.assertRaises(ValueError):
+            result.change_operation(a[0])
+
+    def test_given_changes(self):
+        """Tests the lookup of changes given to the result."""
+        changes = list(calculate_changes(self.t1, self.t2, self.result.mapping))
+        result = DiffResult(self.t1, self.t2, self.result.mapping, changes)
+        self.assertEqual(self.result.change_codes, result.change_codes)
+        self.assertEqual(set(self.result.changes_by_node), set(result.changes_by_node))
+
+    def test_reverse_mapping(self):
+        """Tests the mapping from the other tree to the base tree."""
+        self.assertEqual({v: k for k, v in self.result.mapping.items()}, self.result.reverse_mapping)
+
+    def test_combine_mappings(self):
+        """Tests combining mappings by their common keys."""
+        a, b, c = self.t1, self.t1[0], self.t1[1]
+        x, y, z = self.t2, self.t2[0], self.t2[1]
+        self.assertEqual({x: a, z: c}, combine_mappings({a: x, b: y, c: z}, {a: a, c: c}))
+        self.assertEqual({x: a, z: c}, combine_mappings({a: x, c: z}, {a: a, b: b, c: c}))
+
+    def test_truncated(self):
+        """Tests that a merge result is approximate if any of its diffs is."""
+        base_result = DiffResult(self.t1, self.t1, {}, truncated=('opt',))
+        other_result = DiffResult(self.t1, self.t2, {})
+        self.assertFalse(MergeDiffResult(self.t1, self.t2, self.t1, other_result, other_result).approximate)
+
+        result = MergeDiffResult(self.t1, self.t2, self.t1, base_result, other_result,
+                                 DiffResult(self.t1, self.t2, {}, truncated=('bottom_up',)))
+        self.assertTrue(result.approximate)
+        self.assertEqual({'bottom_up', 'opt'}, result.truncated)
@@ -260,3 +260,55 @@ class EuclidGumTreeTestCase(unittest.TestCase):
         self.assertEqual(n, len(set(result.mapping.keys())))  # Test uniqueness of keys
         self.assertEqual(n, len(set(result.mapping.values())))   # Test uniqueness of values
         self.assertEqual(0, len(result.changes))
+
+    def test_budget(self):
+        t1, t2 = self.t1, self.t2
+        expected = GumTreeDiff()(t1, t2)
+        self.assertFalse(expected.approximate)
+
+        # A sufficient budget yields the exact result
+        result = GumTreeDiff(time_budget=60.0, work_budget=10000)(t1, t2)
+        self.assertEqual(set(expected.mapping.items()), set(result.mapping.items()))
+        self.assertEqual(frozenset(), result.truncated)
+
+        # Without budget only the top down phase runs
+        top_down = GumTreeDiff().top_down(t1, t2)
+        for result in (GumTreeDiff(work_budget=0)(t1, t2), GumTreeDiff(time_budget=0.0)(t1, t2)):
+            self.assertEqual(set(top_down.items()), set(result.mapping.items()))
+            self.assertEqual({'bottom_up'}, result.truncated)
+            self.assertTrue(result.approximate)
+
+        # A budget for visiting the nodes, but not for the edit distances of the larger subtrees
+        result = GumTreeDiff(work_budget=100)(t1, t2)
+        self.assertEqual({'opt'}, result.truncated)
+        self.assertLess(len(top_down), len(result.mapping))
+        self.assertLess(len(result.mapping), len(expected.mapping))
+
+    def test_root_candidates(self):
+        """Tests candidate mappings of the roots, which have no parents to compute the dice coefficient for."""
+        def tree():
+            return Node(typ="A", label="a", children=[Node(typ="B", label="x"), Node(typ="B", label="y")])
+
+        root = tree()
+        copies = Node(typ="R", label="r", children=[tree(), Node(typ="C", label="z", children=[tree()]), tree()])
+        for base, other in ((root, copies), (copies, root)):
+            self.assertEqual(3, len(GumTreeDiff(min_height=1)(base, other).mapping))
+
+    def test_opt_skipped(self):
+        """Tests that the edit distance is not computed for subtrees that are already matched completely."""
+        class CountingGumTreeDiff(GumTreeDiff):
+            calls = 0
+
+            def opt(self, base, other):
+                CountingGumTreeDiff.calls += 1
+                return super(CountingGumTreeDiff, self).opt(base, other)
+
+        other = Node(typ=self.t1.type, label=self.t1.label, children=[*(self._copy(c) for c in self.t1.children),
+                                                                      Node(typ="Extra", label="x")])
+        result = CountingGumTreeDiff(min_height=1)(self.t1, other)
+        self.assertEqual(0, CountingGumTreeDiff.calls)
+        self.assertEqual(self.t1.size, len(result.mapping))
+
+    @classmethod
+    def _copy(cls, node):
+        return Node(typ=node.type, label=node.label, children=[cls._copy(c) for c in node.children])
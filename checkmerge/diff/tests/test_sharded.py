@@ -0,0 +1,75 @@
+import unittest
+
+from checkmerge.diff.base import DiffAlgorithm
+from checkmerge.diff.gumtree import GumTreeDiff
+from checkmerge.diff.sharded import ShardedDiff
+from checkmerge.ir.tree import Node
+
+
+def function(name, *statements, ref=True):
+    return Node(typ="FunctionDef", label=name, ref=f"c:@F@{name}" if ref else None, children=[
+        Node(typ="BasicBlock", children=[
+            Node(typ="VariableDef", label=label, children=[Node(typ="IntegerLiteral", label=value)])
+            for label, value in statements
+        ]),
+    ])
+
+
+class ShardedDiffTestCase(unittest.TestCase):
+    def setUp(self):
+        self.base = Node(typ="TranslationUnit", children=[
+            function("f", ("a", "1"), ("b", "2")),
+            function("g", ("c", "3")),
+            function("h", ("d", "4"), ref=False),
+        ])
+        # Moves g and changes f
+        self.other = Node(typ="TranslationUnit", children=[
+            function("g", ("c", "3")),
+            function("f", ("a", "1"), ("b", "5"), ("e", "6")),
+            function("h", ("d", "4"), ref=False),
+        ])
+
+    def test_pair(self):
+        """Tests the pairing of top-level declarations by reference and by identical subtree."""
+        shards = ShardedDiff.pair(self.base, self.other)
+        self.assertEqual([(self.base[0], self.other[1]), (self.base[1], self.other[0]), (self.base[2], self.other[2])],
+                         shards)
+
+    def test_diff(self):
+        """Tests that identical declarations are mapped wholesale and changed declarations are diffed."""
+        mapping = ShardedDiff()(self.base, self.other).mapping
+
+        self.assertIs(self.other, mapping[self.base])
+        for b, o in ((self.base[1], self.other[0]), (self.base[2], self.other[2])):
+            self.assertEqual(list(zip(b.subtree(), o.subtree())), [(n, mapping[n]) for n in b.subtree()])
+
+        expected = GumTreeDiff()(self.base[0], self.other[1]).mapping
+        self.assertEqual(set(expected.items()), {(n, mapping[n]) for n in self.base[0].subtree() if n in mapping})
+
+    def test_parallel(self):
+        """Tests that shards diffed by worker processes are mapped like shards diffed in process."""
+        self.base.children[1].children[0].children[0].label = "x"
+        sequential = ShardedDiff()(self.base, self.other).mapping
+        parallel = ShardedDiff(workers=2, min_parallel_size=0)(self.base, self.other).mapping
+        self.assertEqual(set(sequential.items()), set(parallel.items()))
+
+    def test_fallback(self):
+        """Tests that the whole trees are diffed if declarations are unpaired in both trees."""
+        self.other.children[1].ref = "c:@F@renamed"
+        self.assertIsNone(ShardedDiff.pair(self.base, self.other))
+
+        expected = GumTreeDiff()(self.base, self.other).mapping
+        self.assertEqual(set(expected.items()), set(ShardedDiff()(self.base, self.other).mapping.items()))
+
+    def test_budget(self):
+        """Tests that the budget is passed on to the engine of every shard."""
+        self.assertEqual(frozenset(), ShardedDiff(time_budget=60.0)(self.base, self.other).truncated)
+        for kwargs in (dict(work_budget=0), dict(time_budget=0.0), dict(work_budget=0, workers=2, min_parallel_size=0)):
+            result = ShardedDiff(**kwargs)(self.base, self.other)
+            expected = GumTreeDiff(work_budget=0)(self.base[0], self.other[1])
+            self.assertEqual({'bottom_up'}, result.truncated)
+            self.assertEqual(set(expected.mapping.items()),
+                             {(n, result.mapping[n]) for n in self.base[0].subtree() if n in result.mapping})
+
+        with self.assertRaises(ValueError):
+            ShardedDiff(engine=DiffAlgorithm, time_budget=1.0)
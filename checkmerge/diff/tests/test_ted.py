@@ -0,0 +1,34 @@
+import unittest
+
+from checkmerge.diff.tests import test_gumtree
+from checkmerge.diff.ted import TreeEditDistance
+from checkmerge.ir.tree import Node
+
+
+class TreeEditDistanceTestCase(unittest.TestCase):
+    """
+    Test case for the Zhang-Shasha tree edit distance.
+    """
+    def setUp(self):
+        test_gumtree.EuclidGumTreeTestCase.setUp(self)
+
+    @staticmethod
+    def unit_cost(a, b):
+        return 0 if a == b else 1
+
+    def test_equal(self):
+        ted = TreeEditDistance(self.t1, self.t1)
+        self.assertEqual(0, ted.distance)
+        self.assertTrue(all(n1.name == n2.name for n1, n2 in ted.closest_subtrees()))
+
+    def test_distance(self):
+        t1 = Node("f", children=[Node("d", children=[Node("a"), Node("c", children=[Node("b")])]), Node("e")])
+        t2 = Node("f", children=[Node("c", children=[Node("d", children=[Node("a"), Node("b")])]), Node("e")])
+        ted = TreeEditDistance(t1, t2, label_dist=self.unit_cost)
+        self.assertEqual(2, ted.distance)
+
+    def test_closest_subtrees(self):
+        t1 = Node("a", children=[Node("b"), Node("c")])
+        t2 = Node("x", children=[Node("c"), Node("a", children=[Node("b"), Node("c")])])
+        ted = TreeEditDistance(t1, t2, label_dist=self.unit_cost)
+        self.assertEqual([(t1, t2[1]), (t1[0], t2[1][0]), (t1[1], t2[0])], ted.closest_subtrees())
@@ -1,9 +1,11 @@
 from checkmerge.ir.tree import Node, Dependency, DependencyType
 from checkmerge.ir.metadata import Metadata, Location, Range
-from checkmerge.ir.graph import GraphVizFormatter
+from checkmerge.ir.graph import DotWriter, GraphVizFormatter, neighbourhood
 
 __all__ = [
+    DotWriter,
     GraphVizFormatter,
+    neighbourhood,
     Metadata,
     Location,
     Range,
@@ -0,0 +1,225 @@
+import array
+import bisect
+import typing
+import weakref
+
+if typing.TYPE_CHECKING:
+    from checkmerge.ir.tree import DependencyType, Node
+
+
+class FlatTree(object):
+    """
+    Flat, array backed representation of an IR tree.
+
+    Nodes are identified by their index in a top-down depth-first (preorder) walk of the tree. The nodes of a subtree
+    therefore form a contiguous range of indices starting at the root of the subtree, and the same holds for the
+    positions of the nodes in a bottom-up depth-first (postorder) walk. Types and labels are interned per tree and
+    dependencies are stored as compressed sparse rows (CSR) of target indices with a type table.
+
+    The flat tree is built once for a complete tree, typically on first use after parsing. Structural changes to the
+    tree and added dependencies mark the flat tree as outdated, after which it is rebuilt on the next use. Derived
+    indices, such as the `references` of definitions, are built on first use and rebuilt along with the flat tree.
+
+    Only the root of the tree keeps its flat tree alive, the other nodes refer to it weakly. The root and its flat tree
+    still refer to each other, which `release()` undoes for trees that are no longer used, so they are freed without
+    waiting for the cyclic garbage collector.
+    """
+    __slots__ = ('valid', 'nodes', 'parent', 'size', 'height', 'postorder', 'postorder_index', 'type_ids', 'label_ids',
+                 'type_names', 'label_names', 'dependency_types', 'dependency_offsets', 'dependency_targets',
+                 'dependency_type_ids', 'reverse_dependency_offsets', 'reverse_dependency_sources',
+                 'reverse_dependency_type_ids', '_references', '__weakref__')
+
+    def __init__(self, root: "Node"):
+        """
+        :param root: The root node of the tree. The nodes of the tree are linked to this representation.
+        """
+        self.valid = True
+
+        # Number the nodes in preorder, the reference to this flat tree is shared by all nodes
+        ref = weakref.ref(self)
+        self.nodes: typing.List["Node"] = []
+        self.parent = array.array('l')
+        stack = [(root, -1)]
+        while stack:
+            node, parent = stack.pop()
+            node._flat = ref
+            node._owned_flat = None
+            node._index = len(self.nodes)
+            self.nodes.append(node)
+            self.parent.append(parent)
+            stack.extend((child, node._index) for child in reversed(node.children))
+
+        root._owned_flat = self
+        n = len(self.nodes)
+
+        # Sizes and heights in a single reverse walk, as all descendants of a node succeed it in preorder
+        self.size = array.array('l', [1]) * n
+        self.height = array.array('l', [1]) * n
+        for i in range(n - 1, 0, -1):
+            p = self.parent[i]
+            self.size[p] += self.size[i]
+            if self.height[i] >= self.height[p]:
+                self.height[p] = self.height[i] + 1
+
+        # Bottom-up walk of the tree
+        self.postorder = array.array('l')
+        self.postorder_index = array.array('l', [0]) * n
+        stack = [(0, False)]
+        while stack:
+            i, visited = stack.pop()
+            if visited:
+                self.postorder_index[i] = len(self.postorder)
+                self.postorder.append(i)
+            else:
+                stack.append((i, True))
+                stack.extend((c._index, False) for c in reversed(self.nodes[i].children))
+
+        # Interned types and labels
+        type_table: typing.Dict[str, int] = {}
+        label_table: typing.Dict[typing.Optional[str], int] = {}
+        self.type_ids = array.array('l', (type_table.setdefault(node.type, len(type_table)) for node in self.nodes))
+        self.label_ids = array.array('l', (label_table.setdefault(node.label, len(label_table)) for node in self.nodes))
+        self.type_names: typing.List[str] = list(type_table)
+        self.label_names: typing.List[typing.Optional[str]] = list(label_table)
+
+        # Dependencies between nodes of this tree in both directions
+        type_ids: typing.Dict["DependencyType", int] = {}
+        forward: typing.List[typing.List[typing.Tuple[int, int]]] = [[] for _ in range(n)]
+        reverse: typing.List[typing.List[typing.Tuple[int, int]]] = [[] for _ in range(n)]
+        for i, node in enumerate(self.nodes):
+            for dependency in node.dependencies:
+                target = dependency.node
+                if target is None or target._flat is not ref:
+                    continue
+                t = type_ids.setdefault(dependency.type, len(type_ids))
+                forward[i].append((target._index, t))
+                reverse[target._index].append((i, t))
+        self.dependency_types: typing.List["DependencyType"] = list(type_ids)
+        self.dependency_offsets, self.dependency_targets, self.dependency_type_ids = self._compress(forward)
+        self.reverse_dependency_offsets, self.reverse_dependency_sources, self.reverse_dependency_type_ids = \
+            self._compress(reverse)
+
+        self._references: typing.Optional[ReferenceIndex] = None
+
+    @staticmethod
+    def _compress(rows: typing.List[typing.List[typing.Tuple[int, int]]]) \
+            -> typing.Tuple[array.array, array.array, array.array]:
+        """Compresses adjacency lists into offsets, indices and type identifiers."""
+        offsets = array.array('l', [0])
+        indices = array.array('l')
+        types = array.array('b')
+        for row in rows:
+            for index, typ in sorted(row):
+                indices.append(index)
+                types.append(typ)
+            offsets.append(len(indices))
+        return offsets, indices, types
+
+    @property
+    def root(self) -> "Node":
+        """The root node of the tree."""
+        return self.nodes[0]
+
+    def release(self) -> None:
+        """
+        Unlinks the tree from this flat representation, which is rebuilt if the tree is used again. Breaks the
+        references between the root and this flat tree, so the tree is freed once it is no longer referenced.
+        """
+        if self.nodes and self.nodes[0]._owned_flat is self:
+            self.nodes[0]._owned_flat = None
+        self.valid = False
+        self.nodes = []
+
+    def subtree(self, i: int, include_self: bool = True) -> range:
+        """The indices of the nodes in the subtree of the given node in preorder."""
+        return range(i if include_self else i + 1, i + self.size[i])
+
+    def reverse_subtree(self, i: int, include_self: bool = True) -> typing.Iterable[int]:
+        """The indices of the nodes in the subtree of the given node in postorder."""
+        end = self.postorder_index[i] + (1 if include_self else 0)
+        return self.postorder[self.postorder_index[i] - self.size[i] + 1:end]
+
+    def ancestors(self, i: int) -> typing.Generator[int, None, None]:
+        """Generator for the ancestors of the given node, starting with its parent."""
+        i = self.parent[i]
+        while i >= 0:
+            yield i
+            i = self.parent[i]
+
+    def contains(self, i: int, j: int) -> bool:
+        """Whether `j` is a descendant of `i`, which is an interval test on the preorder numbering."""
+        return i < j < i + self.size[i]
+
+    def dependencies(self, i: int) -> typing.Generator[typing.Tuple[int, "DependencyType"], None, None]:
+        """Generator for the targets and types of the dependencies of the given node."""
+        for k in range(self.dependency_offsets[i], self.dependency_offsets[i + 1]):
+            yield self.dependency_targets[k], self.dependency_types[self.dependency_type_ids[k]]
+
+    def reverse_dependencies(self, i: int) -> typing.Generator[typing.Tuple[int, "DependencyType"], None, None]:
+        """Generator for the sources and types of the dependencies on the given node."""
+        for k in range(self.reverse_dependency_offsets[i], self.reverse_dependency_offsets[i + 1]):
+            yield self.reverse_dependency_sources[k], self.dependency_types[self.reverse_dependency_type_ids[k]]
+
+    @property
+    def references(self) -> "ReferenceIndex":
+        """The index of the definitions of this tree and their uses. Built on first use."""
+        if self._references is None:
+            self._references = ReferenceIndex(self)
+        return self._references
+
+    def __len__(self):
+        return len(self.nodes)
+
+    def __repr__(self):
+        return f"<FlatTree {self.root if self.nodes else None} ({len(self)} nodes)>"
+
+
+class ReferenceIndex(object):
+    """
+    Index of the definitions of a flat tree and the nodes using them, which are the sources of the reference
+    dependencies on a definition (see `Node.is_definition`).
+
+    The definitions are stored as a sorted array of node indices, so the definitions within a subtree form a contiguous
+    range. The uses of the definitions are stored as compressed sparse rows of node indices aligned with the
+    definitions.
+    """
+    __slots__ = ('flat', 'definitions', 'offsets', 'users')
+
+    def __init__(self, flat: FlatTree):
+        """
+        :param flat: The flat tree to index.
+        """
+        from checkmerge.ir.tree import DependencyType
+
+        self.flat = flat
+        self.definitions = array.array('l')
+        self.offsets = array.array('l', [0])
+        self.users = array.array('l')
+
+        if DependencyType.REFERENCE not in flat.dependency_types:
+            return
+        reference = flat.dependency_types.index(DependencyType.REFERENCE)
+
+        offsets, sources, type_ids = \
+            flat.reverse_dependency_offsets, flat.reverse_dependency_sources, flat.reverse_dependency_type_ids
+        for i in range(len(flat)):
+            users = [sources[k] for k in range(offsets[i], offsets[i + 1]) if type_ids[k] == reference]
+            if users:
+                self.definitions.append(i)
+                self.users.extend(users)
+                self.offsets.append(len(self.users))
+
+    def subtree(self, i: int) -> range:
+        """The positions of the definitions in the subtree of the given node in the definitions array."""
+        end = i + self.flat.size[i]
+        return range(bisect.bisect_left(self.definitions, i), bisect.bisect_left(self.definitions, end))
+
+    def uses(self, i: int) -> array.array:
+        """The indices of the nodes using the given node, which are empty if the node is not a definition."""
+        k = bisect.bisect_left(self.definitions, i)
+        if k == len(self.definitions) or self.definitions[k] != i:
+            return self.users[0:0]
+        return self.users[self.offsets[k]:self.offsets[k + 1]]
+
+    def __len__(self):
+        return len(self.definitions)
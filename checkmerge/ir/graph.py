@@ -1,9 +1,11 @@
 import os
 import typing
+from contextlib import contextmanager
 
 import graphviz
 
 from checkmerge import ir
+from checkmerge.ir.flat import FlatTree
 
 
 class GraphVizFormatter(object):
@@ -113,3 +115,163 @@ class GraphVizFormatter(object):
         """
         path = os.path.split(file)
         self.graph.save(filename=path[-1], directory=os.path.join(*path[:-1]))
+
+
+class DotWriter(object):
+    """
+    Streaming writer of GraphViz DOT source for IR trees, which writes every node and edge to a file as soon as it is
+    added. Unlike `GraphVizFormatter`, no graph is kept in memory, so trees of any size can be exported. As layouts of
+    large graphs are slow, only the neighbourhood of the changed nodes can be written for debugging a conflict instead
+    (see `write_nodes()` and `neighbourhood()`).
+
+    Nodes are identified in the same way as by `GraphVizFormatter`. The writer is a context manager, which writes the
+    end of the graph on exit.
+    """
+
+    def __init__(self, file: typing.TextIO, name: typing.Optional[str] = None):
+        """
+        :param file: The text file to write to.
+        :param name: The name of the graph.
+        """
+        self.file = file
+        self.file.write(f"digraph {_quote(name or '')} {{\n")
+        self._clusters = 0
+
+    def node(self, node: ir.Node, **attributes: str) -> None:
+        """
+        Writes a node.
+
+        :param node: The node to write.
+        :param attributes: Additional GraphViz attributes of the node.
+        """
+        self.file.write(f"\t{_id(node)} {_attributes({'label': str(node), **attributes})}\n")
+
+    def edge(self, source: ir.Node, target: ir.Node, label: typing.Optional[str] = None, **attributes: str) -> None:
+        """
+        Writes an edge between two nodes.
+
+        :param source: The source node.
+        :param target: The target node.
+        :param label: The label of the edge.
+        :param attributes: Additional GraphViz attributes of the edge.
+        """
+        if label is not None:
+            attributes = dict(attributes, label=label)
+        self.file.write(f"\t{_id(source)} -> {_id(target)}{' ' + _attributes(attributes) if attributes else ''}\n")
+
+    @contextmanager
+    def subgraph(self, name: typing.Optional[str] = None) -> typing.Generator[None, None, None]:
+        """
+        Context manager writing the nodes and edges added within a `with` statement to a cluster subgraph.
+
+        :param name: The label of the subgraph.
+        """
+        self._clusters += 1
+        self.file.write(f"subgraph cluster_{self._clusters} {{\n")
+        if name is not None:
+            self.file.write(f"\tlabel={_quote(name)}\n")
+        yield
+        self.file.write("}\n")
+
+    def write_tree(self, t: ir.Node, name: typing.Optional[str] = None, dependencies: bool = False) -> None:
+        """
+        Writes a (sub)tree to a subgraph in a single top-down walk.
+
+        :param t: The root of the tree to write.
+        :param name: The name of the subgraph.
+        :param dependencies: Whether to write the dependencies of the nodes as well.
+        """
+        with self.subgraph(name):
+            for node in t.nodes:
+                self.node(node)
+                for child in node.children:
+                    self.edge(node, child)
+                if dependencies:
+                    for dependency in node.dependencies:
+                        if dependency.node is not None:
+                            self.edge(node, dependency.node, str(dependency.type), color='red')
+
+    def write_nodes(self, nodes: typing.Iterable[ir.Node], highlight: typing.Iterable[ir.Node] = ()) -> None:
+        """
+        Writes a selection of nodes to a subgraph per tree. Every node is connected to its closest selected ancestor,
+        with a dashed edge if nodes in between are left out. The dependencies between the selected nodes and the
+        mappings between selected nodes of different trees are written as well.
+
+        :param nodes: The nodes to write.
+        :param highlight: The nodes to highlight, such as the changed nodes of a conflict.
+        """
+        selected = set(nodes)
+        highlight = set(highlight)
+
+        trees: typing.Dict[FlatTree, typing.List[ir.Node]] = {}
+        for node in selected:
+            trees.setdefault(node.flat, []).append(node)
+
+        for flat, tree_nodes in trees.items():
+            tree_nodes.sort(key=lambda n: n.index)
+            with self.subgraph(str(flat.root)):
+                for node in tree_nodes:
+                    self.node(node, **({'color': 'red', 'style': 'bold'} if node in highlight else {}))
+
+                    parent = node.parent
+                    while parent is not None and parent not in selected:
+                        parent = parent.parent
+                    if parent is not None:
+                        self.edge(parent, node, **({} if parent is node.parent else {'style': 'dashed'}))
+
+        for node in selected:
+            for dependency in node.dependencies:
+                if dependency.node in selected:
+                    self.edge(node, dependency.node, str(dependency.type), color='red')
+            if node.mapping in selected and node.mapping.flat is not node.flat and id(node) < id(node.mapping):
+                self.edge(node, node.mapping, color='blue', style='dotted', dir='none', constraint='false')
+
+    def close(self) -> None:
+        """Writes the end of the graph."""
+        self.file.write("}\n")
+
+    def __enter__(self) -> "DotWriter":
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.close()
+        return False
+
+
+def neighbourhood(nodes: typing.Iterable[ir.Node], hops: int = 1) -> typing.Set[ir.Node]:
+    """
+    Collects the neighbourhood of the given nodes, such as the changed nodes of a conflict: the nodes reachable over
+    dependencies in either direction within the given number of hops, and the mapped counterparts of all these nodes.
+
+    :param nodes: The nodes to start from.
+    :param hops: The maximum number of dependencies to follow from a node.
+    :return: The nodes in the neighbourhood, including the given nodes.
+    """
+    result = set(nodes)
+    frontier = list(result)
+
+    for _ in range(hops):
+        reached = []
+        for node in frontier:
+            for dependency in (*node.dependencies, *node.reverse_dependencies):
+                if dependency.node is not None and dependency.node not in result:
+                    result.add(dependency.node)
+                    reached.append(dependency.node)
+        frontier = reached
+
+    result.update([node.mapping for node in result if node.mapping is not None])
+    return result
+
+
+def _id(node: ir.Node) -> str:
+    return _quote(hex(hash(node)))
+
+
+def _quote(value: str) -> str:
+    """Quotes a string as a DOT identifier."""
+    return '"' + value.replace('\\', '\\\\').replace('"', '\\"').replace('\n', '\\n') + '"'
+
+
+def _attributes(attributes: typing.Dict[str, str]) -> str:
+    """Formats a list of GraphViz attributes."""
+    return '[' + ', '.join(f"{key}={_quote(value)}" for key, value in attributes.items()) + ']'
@@ -1,3 +1,4 @@
+import sys
 import typing
 from functools import total_ordering
 
@@ -29,8 +30,8 @@ class Location(object):
         :param line: The line number in the file.
         :param column: The column number in the line.
         """
-        # Set properties
-        self.file: str = file
+        # Set properties, the file name is shared by all locations in the file
+        self.file: str = sys.intern(file) if type(file) is str else file
         self.line: int = line
         self.column: int = column
 
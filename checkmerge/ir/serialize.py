@@ -0,0 +1,274 @@
+import array
+import struct
+import sys
+import typing
+import zlib
+
+from checkmerge.ir.metadata import Location, Metadata, Range
+from checkmerge.ir.tree import Dependency, DependencyType, Node
+
+
+#: Identifies serialized IR trees.
+MAGIC = b'CMIR'
+
+#: The version of the serialization format, which is increased on every incompatible change.
+VERSION = 2
+
+# Dependency types by their serialized identifier
+_dependency_types: typing.List[DependencyType] = list(DependencyType)
+
+# Serialized identifiers of the metadata types and the number of integers in their records
+_location_metadata, _range_metadata = 0, 1
+_metadata_sizes = {_location_metadata: 3, _range_metadata: 6}
+
+# Header of an array: its type code and its number of items
+_array_header = struct.Struct('<cQ')
+
+
+def _write(out: typing.List[bytes], typecode: str, values: typing.Iterable[int]) -> None:
+    """Appends an array of fixed-width little-endian integers of the given type to the output."""
+    values = array.array(typecode, values)
+    if sys.byteorder != 'little':
+        values.byteswap()
+    out.append(_array_header.pack(typecode.encode('ascii'), len(values)))
+    out.append(values.tobytes())
+
+
+class _Reader(object):
+    """Reads the arrays written by `_write()`, validating their type codes and lengths."""
+
+    def __init__(self, data: bytes):
+        self.data = memoryview(data)
+        self.offset = 0
+
+    def read(self, typecode: str, length: typing.Optional[int] = None) -> array.array:
+        """
+        :param typecode: The expected type code of the array.
+        :param length: The expected number of items, or `None` if any number is allowed.
+        :return: The array.
+        """
+        if self.offset + _array_header.size > len(self.data):
+            raise ValueError("The serialized IR trees are truncated.")
+        code, n = _array_header.unpack_from(self.data, self.offset)
+        self.offset += _array_header.size
+
+        values = array.array(typecode)
+        end = self.offset + n * values.itemsize
+        if code != typecode.encode('ascii') or (length is not None and n != length) or end > len(self.data):
+            raise ValueError("The serialized IR trees are malformed.")
+
+        values.frombytes(self.data[self.offset:end])
+        if sys.byteorder != 'little':
+            values.byteswap()
+        self.offset = end
+        return values
+
+    def done(self) -> None:
+        """Checks that all data has been read."""
+        if self.offset != len(self.data):
+            raise ValueError("The serialized IR trees are followed by unexpected data.")
+
+
+def _check_range(values: typing.Iterable[int], low: int, high: int) -> None:
+    """Checks that all values lie within [low, high)."""
+    if any(not low <= v < high for v in values):
+        raise ValueError("The serialized IR trees are malformed.")
+
+
+def dumps(trees: typing.Iterable[Node]) -> bytes:
+    """
+    Serializes IR trees into a compact binary form.
+
+    The trees are stored in their flat representation (see `FlatTree`): structure, types, labels, references, source
+    ranges, metadata and the dependencies between nodes of the same tree are kept. Strings are stored once in a string
+    table, and all per node data is stored in arrays of fixed-width little-endian integers, which are compressed as a
+    whole. Only locations and ranges are supported as metadata. Mappings and change information are not kept. Subtrees
+    can be serialized as well, in which case they are restored as complete trees.
+
+    The format contains plain data only, so loading it never runs code (see `loads()`).
+
+    :param trees: The roots of the trees to serialize.
+    :return: The serialized trees.
+    """
+    strings: typing.Dict[typing.Optional[str], int] = {None: 0}
+
+    def string(value: typing.Optional[str]) -> int:
+        return strings.setdefault(value, len(strings))
+
+    def location(value: Location) -> typing.Tuple[int, int, int]:
+        return string(value.file), value.line, value.column
+
+    out: typing.List[bytes] = []
+    count = 0
+
+    for root in trees:
+        flat = root.flat
+        offset, n = root.index, root.size
+        nodes = flat.nodes[offset:offset + n]
+        count += 1
+
+        # Structure relative to the root, which is not necessarily the root of its flat tree
+        parent = array.array('q', (p - offset for p in flat.parent[offset:offset + n]))
+        parent[0] = -1
+
+        # Source ranges as file and coordinates of both ends
+        ranges = array.array('q')
+        for node in nodes:
+            r = node.source_range
+            if r is None:
+                ranges.extend((0, 0, 0, 0, 0))
+            else:
+                ranges.extend((string(r.start.file), r.start.line, r.start.column, r.end.line, r.end.column))
+
+        # Metadata as records of their type and values
+        metadata_offsets, metadata = array.array('q', [0]), array.array('q')
+        for node in nodes:
+            for m in node.metadata:
+                if isinstance(m, Range):
+                    metadata.extend((_range_metadata, *location(m.start), *location(m.end)))
+                elif isinstance(m, Location):
+                    metadata.extend((_location_metadata, *location(m)))
+                else:
+                    raise TypeError(f"Metadata of type {m.__class__.__name__} cannot be serialized.")
+            metadata_offsets.append(len(metadata))
+
+        # Dependencies within the serialized tree
+        offsets, targets, dependency_types = array.array('q', [0]), array.array('q'), array.array('B')
+        for i in range(offset, offset + n):
+            for target, typ in flat.dependencies(i):
+                if offset <= target < offset + n:
+                    targets.append(target - offset)
+                    dependency_types.append(_dependency_types.index(typ))
+            offsets.append(len(targets))
+
+        _write(out, 'q', parent)
+        _write(out, 'q', (string(node.type) for node in nodes))
+        _write(out, 'q', (string(node.label) for node in nodes))
+        _write(out, 'q', (string(node.ref) for node in nodes))
+        _write(out, 'q', ranges)
+        _write(out, 'B', (2 if node._is_memory_operation is None else int(node._is_memory_operation) for node in nodes))
+        _write(out, 'q', metadata_offsets)
+        _write(out, 'q', metadata)
+        _write(out, 'q', offsets)
+        _write(out, 'q', targets)
+        _write(out, 'B', dependency_types)
+
+    # String table as the lengths of the encoded strings followed by their concatenation, None is not stored
+    encoded = [s.encode('utf-8', errors='surrogatepass') for s in list(strings)[1:]]
+    header: typing.List[bytes] = []
+    _write(header, 'Q', (count,))
+    _write(header, 'Q', (len(s) for s in encoded))
+    _write(header, 'B', b''.join(encoded))
+
+    return MAGIC + bytes((VERSION,)) + zlib.compress(b''.join(header + out))
+
+
+def loads(value: bytes) -> typing.List[Node]:
+    """
+    Deserializes IR trees serialized with `dumps()`. The data is validated while it is read, so data from untrusted
+    sources is rejected with a `ValueError` rather than resulting in invalid trees.
+
+    :param value: The serialized trees.
+    :return: The roots of the deserialized trees.
+    """
+    if value[:len(MAGIC)] != MAGIC:
+        raise ValueError("The data does not contain serialized IR trees.")
+    if len(value) <= len(MAGIC) or value[len(MAGIC)] != VERSION:
+        version = value[len(MAGIC)] if len(value) > len(MAGIC) else None
+        raise ValueError(f"Version {version} of the IR serialization format is not supported.")
+
+    try:
+        reader = _Reader(zlib.decompress(value[len(MAGIC) + 1:]))
+    except zlib.error as e:
+        raise ValueError(f"The serialized IR trees cannot be decompressed. {e}")
+
+    # String table
+    count = reader.read('Q', 1)[0]
+    lengths = reader.read('Q')
+    text = reader.read('B', sum(lengths)).tobytes()
+    strings: typing.List[typing.Optional[str]] = [None]
+    position = 0
+    try:
+        for length in lengths:
+            strings.append(sys.intern(str(text[position:position + length], 'utf-8', errors='surrogatepass')))
+            position += length
+    except UnicodeDecodeError as e:
+        raise ValueError(f"The serialized IR trees contain an invalid string. {e}")
+
+    def location(values: typing.Sequence[int]) -> Location:
+        return Location(strings[values[0]] or '', values[1], values[2])
+
+    trees = []
+
+    for _ in range(count):
+        parent = reader.read('q')
+        n = len(parent)
+        types, labels, refs = reader.read('q', n), reader.read('q', n), reader.read('q', n)
+        ranges = reader.read('q', 5 * n)
+        memory_operations = reader.read('B', n)
+        metadata_offsets = reader.read('q', n + 1)
+        metadata_values = reader.read('q', metadata_offsets[-1])
+        offsets = reader.read('q', n + 1)
+        targets = reader.read('q', offsets[-1])
+        dependency_types = reader.read('B', len(targets))
+
+        # Validate structure and references into the string table before building nodes
+        if n == 0 or parent[0] != -1 or any(not 0 <= parent[i] < i for i in range(1, n)):
+            raise ValueError("The serialized IR trees are malformed.")
+        for values in (types, labels, refs, ranges[::5]):
+            _check_range(values, 0, len(strings))
+        _check_range(memory_operations, 0, 3)
+        _check_range(targets, 0, n)
+        _check_range(dependency_types, 0, len(_dependency_types))
+        for offsets_array in (metadata_offsets, offsets):
+            if offsets_array[0] != 0 or any(a > b for a, b in zip(offsets_array, offsets_array[1:])):
+                raise ValueError("The serialized IR trees are malformed.")
+
+        # Metadata records per node
+        metadata: typing.Dict[int, typing.List[Metadata]] = {}
+        for i in range(n):
+            k, end = metadata_offsets[i], metadata_offsets[i + 1]
+            while k < end:
+                kind = metadata_values[k]
+                size = _metadata_sizes.get(kind)
+                if size is None or k + 1 + size > end:
+                    raise ValueError("The serialized IR trees contain invalid metadata.")
+                values = metadata_values[k + 1:k + 1 + size]
+                _check_range(values[::3], 0, len(strings))
+                if kind == _range_metadata:
+                    metadata.setdefault(i, []).append(Range(location(values[:3]), location(values[3:])))
+                else:
+                    metadata.setdefault(i, []).append(location(values))
+                k += 1 + size
+
+        nodes: typing.List[typing.Optional[Node]] = [None] * n
+        children: typing.List[typing.List[Node]] = [[] for _ in range(n)]
+
+        # Build the nodes bottom up as children succeed their parents in preorder
+        for i in range(n - 1, -1, -1):
+            file, start_line, start_column, end_line, end_column = ranges[5 * i:5 * i + 5]
+            source_range = None
+            if file:
+                source_range = Range(Location(strings[file], start_line, start_column),
+                                     Location(strings[file], end_line, end_column))
+
+            memory_operation = memory_operations[i]
+            children[i].reverse()
+
+            nodes[i] = Node(strings[types[i]], label=strings[labels[i]], ref=strings[refs[i]], children=children[i],
+                            source_range=source_range, metadata=metadata.get(i),
+                            is_memory_operation=None if memory_operation == 2 else bool(memory_operation))
+
+            if parent[i] >= 0:
+                children[parent[i]].append(nodes[i])
+
+        # Restore dependencies
+        for i, node in enumerate(nodes):
+            if offsets[i] < offsets[i + 1]:
+                node.add_dependencies(*(Dependency(nodes[targets[k]], _dependency_types[dependency_types[k]])
+                                        for k in range(offsets[i], offsets[i + 1])))
+
+        trees.append(nodes[0])
+
+    reader.done()
+    return trees
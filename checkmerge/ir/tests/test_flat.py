@@ -0,0 +1,81 @@
+import gc
+import unittest
+import weakref
+
+from checkmerge.ir.tree import Node, Dependency, DependencyType
+
+
+class FlatTreeTestCase(unittest.TestCase):
+    def setUp(self):
+        self.root = Node("root", label="2")
+        self.l = Node("child", label="7", parent=self.root)
+        self.ll = Node("child", label="2", parent=self.l)
+        self.lr = Node("child", label="6", parent=self.l)
+        self.r = Node("leaf", label="5", parent=self.root)
+
+    def test_structure(self):
+        """Tests the arrays describing the structure of the tree."""
+        flat = self.root.flat
+        self.assertIs(flat, self.lr.flat)
+        self.assertEqual([self.root, self.l, self.ll, self.lr, self.r], flat.nodes)
+        self.assertEqual([-1, 0, 1, 1, 0], list(flat.parent))
+        self.assertEqual([5, 3, 1, 1, 1], list(flat.size))
+        self.assertEqual([3, 2, 1, 1, 1], list(flat.height))
+        self.assertEqual([2, 3, 1, 4, 0], list(flat.postorder))
+        self.assertEqual([1, 2, 3], list(flat.subtree(self.l.index)))
+        self.assertEqual([2, 3, 1], list(flat.reverse_subtree(self.l.index)))
+        self.assertEqual([1, 0], list(flat.ancestors(self.lr.index)))
+        self.assertTrue(flat.contains(self.l.index, self.lr.index))
+        self.assertFalse(flat.contains(self.l.index, self.r.index))
+        self.assertEqual(["root", "child", "child", "child", "leaf"],
+                         [flat.type_names[t] for t in flat.type_ids])
+
+    def test_dependencies(self):
+        """Tests the compressed dependency arrays in both directions."""
+        self.ll.add_dependencies(Dependency(self.r, DependencyType.FLOW))
+        self.lr.add_dependencies(Dependency(self.r, DependencyType.REFERENCE))
+        flat = self.root.flat
+        self.assertEqual([(4, DependencyType.FLOW)], list(flat.dependencies(self.ll.index)))
+        self.assertEqual({(2, DependencyType.FLOW), (3, DependencyType.REFERENCE)},
+                         set(flat.reverse_dependencies(self.r.index)))
+        self.assertEqual([], list(flat.dependencies(self.r.index)))
+
+    def test_mutation(self):
+        """Tests that adding and removing children marks the flat tree as outdated."""
+        flat = self.root.flat
+        n = Node("child", label="1")
+        self.l.add_child(n, 1)
+        self.assertFalse(flat.valid)
+        self.assertEqual([self.root, self.l, self.ll, n, self.lr, self.r], self.root.flat.nodes)
+
+        flat = self.root.flat
+        self.l.remove_child(self.ll)
+        self.assertFalse(flat.valid)
+        self.assertIsNone(self.ll.parent)
+        self.assertEqual(4, self.l.index + self.l.size)
+        with self.assertRaises(ValueError):
+            self.r.add_child(n)
+
+    def test_release(self):
+        """Tests that a tree is freed without the cyclic garbage collector once its flat tree is released."""
+        root = Node("root", children=[Node("child", children=[Node("leaf")])])
+        leaf = weakref.ref(root.children[0].children[0])
+        self.assertEqual(2, leaf().index)
+
+        gc.disable()
+        try:
+            root.release_flat()
+            root = weakref.ref(root)
+            self.assertIsNone(root())
+            self.assertIsNone(leaf())
+        finally:
+            gc.enable()
+
+    def test_invalidate(self):
+        """Tests rebuilding the flat tree after a structural change."""
+        flat = self.root.flat
+        n = Node("child", label="1", parent=self.r)
+        self.assertFalse(flat.valid)
+        self.assertEqual(6, len(self.root.flat))
+        self.assertEqual(5, n.index)
+        self.assertEqual(2, self.r.size)
@@ -0,0 +1,49 @@
+import io
+import unittest
+
+from checkmerge.ir import DotWriter, neighbourhood
+from checkmerge.ir.tree import Node, Dependency, DependencyType
+
+
+class DotWriterTestCase(unittest.TestCase):
+    def setUp(self):
+        self.root = Node("root", label="main")
+        self.l = Node("child", label='say "hi"', parent=self.root)
+        self.ll = Node("leaf", label="a", parent=self.l)
+        self.r = Node("child", label="b", parent=self.root)
+        self.rl = Node("leaf", label="c", parent=self.r)
+        self.ll.add_dependencies(Dependency(self.rl, DependencyType.FLOW))
+        self.rl.add_dependencies(Dependency(self.r, DependencyType.REFERENCE))
+
+    def write(self, func) -> str:
+        out = io.StringIO()
+        with DotWriter(out, "test") as writer:
+            func(writer)
+        return out.getvalue()
+
+    def test_tree(self):
+        """Tests writing a whole tree with dependencies."""
+        source = self.write(lambda w: w.write_tree(self.root, dependencies=True))
+        self.assertTrue(source.startswith('digraph "test" {\n'))
+        self.assertTrue(source.endswith('}\n}\n'))
+        self.assertEqual(5, source.count('[label='))
+        self.assertEqual(4 + 2, source.count(' -> '))
+        self.assertIn('\\"hi\\"', source)
+
+    def test_neighbourhood(self):
+        """Tests collecting the neighbourhood of a node within a number of dependencies."""
+        self.assertEqual({self.ll}, neighbourhood([self.ll], hops=0))
+        self.assertEqual({self.ll, self.rl}, neighbourhood([self.ll], hops=1))
+        self.assertEqual({self.ll, self.rl, self.r}, neighbourhood([self.ll], hops=2))
+
+        other = Node("leaf", label="a")
+        self.ll.mapping, other.mapping = other, self.ll
+        self.assertEqual({self.ll, other}, neighbourhood([self.ll], hops=0))
+
+    def test_nodes(self):
+        """Tests writing a selection of nodes, connected to their closest selected ancestors."""
+        source = self.write(lambda w: w.write_nodes([self.root, self.ll, self.rl], highlight=[self.ll]))
+        self.assertEqual(3, source.count('[label='))
+        self.assertEqual(2, source.count('style="dashed"'))
+        self.assertEqual(1, source.count(f'label="{DependencyType.FLOW}"'))
+        self.assertEqual(1, source.count('style="bold"'))
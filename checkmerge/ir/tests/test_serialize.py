@@ -0,0 +1,69 @@
+import unittest
+import zlib
+
+from checkmerge.ir import serialize
+from checkmerge.ir.metadata import Location, Metadata, Range
+from checkmerge.ir.tree import Node, Dependency, DependencyType
+
+
+class SerializeTestCase(unittest.TestCase):
+    def setUp(self):
+        def r(line):
+            return Range(Location("file.c", line, 1), Location("file.c", line, 10))
+
+        self.root = Node("root", label="file.c", source_range=r(1), metadata=[r(4), Location("other.c", 5, 2)])
+        self.l = Node("child", label="7", ref="c:@l", parent=self.root, source_range=r(2))
+        self.ll = Node("child", parent=self.l, is_memory_operation=True)
+        self.r = Node("leaf", label="", parent=self.root, source_range=r(3))
+        self.ll.add_dependencies(Dependency(self.r, DependencyType.FLOW))
+        self.r.add_dependencies(Dependency(self.l, DependencyType.REFERENCE))
+
+    @staticmethod
+    def describe(root):
+        index = {n: i for i, n in enumerate(root.subtree())}
+        return [(n.type, n.label, n.ref, n.source_range and n.source_range.as_tuple(), n._is_memory_operation,
+                 index.get(n.parent), sorted((index[d.node], d.type.value) for d in n.dependencies),
+                 sorted((index[d.node], d.type.value) for d in n.reverse_dependencies))
+                for n in root.subtree()]
+
+    def test_roundtrip(self):
+        """Tests that serialized trees are restored with structure, data and dependencies."""
+        trees = serialize.loads(serialize.dumps([self.root, self.l]))
+        self.assertEqual(2, len(trees))
+        self.assertEqual(self.describe(self.root), self.describe(trees[0]))
+        self.assertEqual(self.root.hash, trees[0].hash)
+        self.assertEqual([n.hash for n in self.l.subtree()], [n.hash for n in trees[1].subtree()])
+
+    def test_invalid(self):
+        """Tests that data in another format is rejected."""
+        with self.assertRaises(ValueError):
+            serialize.loads(b'CMIR\xff')
+        with self.assertRaises(ValueError):
+            serialize.loads(b'YAML')
+
+    def test_metadata(self):
+        """Tests that locations and ranges are restored as metadata, and that other metadata is rejected."""
+        root = serialize.loads(serialize.dumps([self.root]))[0]
+        self.assertEqual([m.as_tuple() for m in self.root.metadata], [m.as_tuple() for m in root.metadata])
+
+        with self.assertRaises(TypeError):
+            serialize.dumps([Node("root", metadata=[Metadata()])])
+
+    def test_malformed(self):
+        """Tests that corrupted data is rejected while it is read."""
+        value = serialize.dumps([self.root])
+        payload = bytearray(zlib.decompress(value[5:]))
+
+        # Truncated data and trailing data
+        for data in (payload[:-1], payload + b'\x00'):
+            with self.assertRaises(ValueError):
+                serialize.loads(value[:5] + zlib.compress(bytes(data)))
+
+        # Every single corrupted byte either yields trees or is rejected
+        for i in range(len(payload)):
+            data = bytearray(payload)
+            data[i] ^= 0xff
+            try:
+                serialize.loads(value[:5] + zlib.compress(bytes(data)))
+            except ValueError:
+                pass
@@ -39,6 +39,9 @@ class IRNodeTestCase(unittest.TestCase):
         self.assertEqual(self.root.hash, self.root.hash)
         self.assertNotEqual(self.l.hash, self.r.hash)
         self.assertEqual(self.rrl.hash, Node("child", label="4").hash)
+        self.assertEqual(Node.hash_size, len(self.root.hash))
+        self.assertNotEqual(Node("child", label="").hash, Node("child").hash)
+        self.assertNotEqual(Node("a", children=[Node("b")]).hash, Node("a", children=[Node("b"), Node("b")]).hash)
 
     def test_subtree(self):
         """Tests the top down walking of subtrees."""
@@ -94,3 +97,15 @@ class IRNodeTestCase(unittest.TestCase):
         self.assertFalse(self.r.is_memory_operation)
         self.assertFalse(self.rr.is_memory_operation)
         self.assertFalse(self.rrl.is_memory_operation)
+
+    def test_compact(self):
+        """Tests that nodes share strings and empty containers."""
+        self.assertIs(self.l.type, Node("".join(("ch", "ild"))).type)
+        self.assertIs(self.root.dependencies, self.rr.reverse_dependencies)
+        self.assertIs(self.root.metadata, self.rr.metadata)
+
+        # Containers are allocated for the first dependency
+        self.ll.add_dependencies(Dependency(self.lr, DependencyType.FLOW))
+        self.assertIsNot(self.ll.dependencies, self.root.dependencies)
+        self.assertEqual({Dependency(self.ll, DependencyType.FLOW)}, self.lr.reverse_dependencies)
+        self.assertEqual(set(), self.root.dependencies)
@@ -1,9 +1,11 @@
 import enum
 import hashlib
+import sys
 import typing
 import weakref
 from functools import total_ordering
 
+from checkmerge.ir.flat import FlatTree
 from checkmerge.ir.metadata import Location, Metadata, Range
 
 
@@ -119,6 +121,11 @@ class Dependency(object):
         return f"{self.type} {self.node}"
 
 
+# Shared empty containers of nodes without dependencies or metadata
+_no_dependencies: typing.FrozenSet[Dependency] = frozenset()
+_no_metadata: typing.Tuple[Metadata, ...] = ()
+
+
 @total_ordering
 class Node(object):
     """
@@ -126,10 +133,20 @@ class Node(object):
 
     References to the children of a node are strong, while references to the parent are weak to allow for proper garbage
     collection. It is therefore important to keep a reference to the root of the tree.
+
+    Walks of the tree and structural properties such as the height are served by the flat representation of the tree
+    (see `FlatTree`), which is built on first use and rebuilt after the structure of the tree changes.
+
+    Trees of large programs have millions of nodes, so nodes are kept small: the type, label and reference strings are
+    interned, so equal strings are stored once, and nodes without dependencies or metadata share empty containers.
+    The sets of dependencies are only allocated when the first dependency is added.
     """
+    #: The size in bytes of the subtree hashes.
+    hash_size: int = 16
+
     __slots__ = ('type', 'label', 'ref', '_parent', 'children', 'source_range', 'metadata', '_is_memory_operation',
-                 '_dependencies', '_reverse_dependencies', '_mapping', '_changed', '_height', '_hash', '_hash_str',
-                 '_root', '__weakref__')
+                 '_dependencies', '_reverse_dependencies', '_mapping', '_changed', '_hash', '_flat', '_owned_flat',
+                 '_index', '__weakref__')
 
     def __init__(self, typ: str, label: typing.Optional[str] = None, ref: typing.Optional[str] = None,
                  parent: typing.Optional["Node"] = None,
@@ -147,15 +164,20 @@ class Node(object):
         :param metadata: The metadata of this node.
         :param is_memory_operation: Overrides the automatic detection of memory operations for analysis purposes.
         """
+        # Not part of a flat tree until one is built. Nodes refer to it weakly, only the root keeps it alive.
+        self._flat: typing.Optional[weakref.ReferenceType] = None
+        self._owned_flat: typing.Optional[FlatTree] = None
+        self._index: int = 0
+
         # Initialize and set fields from arguments
-        self.type: str = typ
-        self.label: typing.Optional[str] = label
-        self.ref: typing.Optional[str] = ref
+        self.type: str = sys.intern(typ) if type(typ) is str else typ
+        self.label: typing.Optional[str] = sys.intern(label) if type(label) is str else label
+        self.ref: typing.Optional[str] = sys.intern(ref) if type(ref) is str else ref
         self._parent = None
         self.parent = parent
         self.children: typing.List[Node] = children if children is not None else []
         self.source_range = source_range
-        self.metadata: typing.List[Metadata] = metadata if metadata is not None else []
+        self.metadata: typing.Sequence[Metadata] = metadata if metadata else _no_metadata
         self._is_memory_operation: typing.Optional[bool] = is_memory_operation
 
         # Check children and set parent
@@ -167,16 +189,14 @@ class Node(object):
         # Check parent and add as child
         if self.parent is not None and self not in self.parent.children:
             self.parent.children.append(self)
+            self.parent._invalidate()
 
         # Initialize fields
-        self._dependencies: typing.Set[Dependency] = set()
-        self._reverse_dependencies: typing.Set[Dependency] = set()
+        self._dependencies: typing.Optional[typing.Set[Dependency]] = None
+        self._reverse_dependencies: typing.Optional[typing.Set[Dependency]] = None
         self._mapping: typing.Optional[Node] = None
         self._changed: typing.Optional[bool] = None
-        self._height = None
         self._hash = None
-        self._hash_str = None
-        self._root = None
 
     @property
     def parent(self) -> typing.Optional["Node"]:
@@ -188,6 +208,7 @@ class Node(object):
     @parent.setter
     def parent(self, value: typing.Optional["Node"]):
         """Setter for the parent node that uses a weak reference to allow garbage collection."""
+        self._invalidate()
         if value is None:
             self._parent = None
         else:
@@ -195,10 +216,11 @@ class Node(object):
 
     @property
     def root(self) -> "Node":
-        """The root node of the tree."""
-        if self._root is None:
-            self._root = self.parent.root if self.parent is not None else self
-        return self._root
+        """The root node of the tree. Not cached, as a strong reference to the root would keep the tree alive."""
+        root = self
+        while root.parent is not None:
+            root = root.parent
+        return root
 
     @property
     def location(self) -> typing.Optional[Location]:
@@ -240,14 +262,14 @@ class Node(object):
         return False
 
     @property
-    def dependencies(self) -> typing.Set[Dependency]:
+    def dependencies(self) -> typing.AbstractSet[Dependency]:
         """The dependencies of this node."""
-        return self._dependencies
+        return self._dependencies if self._dependencies is not None else _no_dependencies
 
     @property
-    def reverse_dependencies(self) -> typing.Set[Dependency]:
+    def reverse_dependencies(self) -> typing.AbstractSet[Dependency]:
         """The dependencies on this node."""
-        return self._reverse_dependencies
+        return self._reverse_dependencies if self._reverse_dependencies is not None else _no_dependencies
 
     def add_dependencies(self, *dependencies: Dependency) -> None:
         """
@@ -255,9 +277,17 @@ class Node(object):
 
         :param dependencies: The dependencies to add.
         """
+        if not dependencies:
+            return
+        if self._dependencies is None:
+            self._dependencies = set()
         for dependency in dependencies:
             self._dependencies.add(dependency)
-            dependency.node._reverse_dependencies.add(Dependency(self, dependency.type, reverse=True))
+            target = dependency.node
+            if target._reverse_dependencies is None:
+                target._reverse_dependencies = set()
+            target._reverse_dependencies.add(Dependency(self, dependency.type, reverse=True))
+        self._invalidate()
 
     @property
     def mapping(self) -> typing.Optional["Node"]:
@@ -275,6 +305,11 @@ class Node(object):
         assert self._mapping is None
         self._mapping = value
 
+    def untag(self) -> None:
+        """Removes the mapping and the change status of this node, so the result of another diff can be applied."""
+        self._mapping = None
+        self._changed = None
+
     @property
     def is_changed(self) -> bool:
         """Whether this node has been changed. This is only known if the diff result was applied to the tree."""
@@ -304,75 +339,122 @@ class Node(object):
         return len(self.children) == 0
 
     @property
-    def descendants(self) -> typing.Generator["Node", None, None]:
-        """Generator for the descendants of this node. Yields the descendants top-down in a depth-first manner."""
-        for child in self.children:
-            yield child
-            yield from child.descendants
+    def flat(self) -> FlatTree:
+        """The flat representation of the tree this node is part of. Built on first use."""
+        flat = self._flat() if self._flat is not None else None
+        if flat is None or not flat.valid:
+            flat = FlatTree(self.root)
+        return flat
 
     @property
-    def nodes(self) -> typing.Generator["Node", None, None]:
-        """Generator for the nodes in this subtree. Yields the nodes top-down in a depth-first manner."""
-        yield self
-        yield from self.descendants
+    def index(self) -> int:
+        """The index of this node in a top-down depth-first walk of its tree."""
+        # Ensure the index is up to date
+        self.flat
+        return self._index
+
+    def add_child(self, child: "Node", index: typing.Optional[int] = None) -> None:
+        """
+        Adds a child to this node. Changes to the structure of a tree should be made through this method or
+        `remove_child()`, which mark the flat representation of the tree as outdated.
+
+        :param child: The node to add, which must not have a parent.
+        :param index: The position among the children to insert the child at, or `None` to append it.
+        """
+        if child.parent is not None:
+            raise ValueError("A child cannot be added if a parent is already set.")
+        child.parent = self
+        if index is None:
+            self.children.append(child)
+        else:
+            self.children.insert(index, child)
+        self._invalidate()
+
+    def remove_child(self, child: "Node") -> None:
+        """
+        Removes a child from this node, after which the child is the root of its own tree.
+
+        :param child: The child to remove.
+        """
+        self.children.remove(child)
+        child.parent = None
+        self._invalidate()
+
+    def release_flat(self) -> None:
+        """Releases the flat representation of the tree of this node, if any (see `FlatTree.release()`)."""
+        flat = self._flat() if self._flat is not None else None
+        if flat is not None:
+            flat.release()
+
+    def _invalidate(self) -> None:
+        """Marks the flat representation of the tree of this node as outdated after a change to the tree."""
+        flat = self._flat() if self._flat is not None else None
+        if flat is not None:
+            flat.valid = False
+
+    @property
+    def descendants(self) -> typing.Iterator["Node"]:
+        """Iterator over the descendants of this node. Yields the descendants top-down in a depth-first manner."""
+        flat = self.flat
+        return map(flat.nodes.__getitem__, flat.subtree(self._index, include_self=False))
+
+    @property
+    def nodes(self) -> typing.Iterator["Node"]:
+        """Iterator over the nodes in this subtree. Yields the nodes top-down in a depth-first manner."""
+        flat = self.flat
+        return map(flat.nodes.__getitem__, flat.subtree(self._index))
 
     @property
     def height(self) -> int:
         """The height of the subtree."""
-        if self._height is None:
-            self._height = self._get_height()
-        return self._height
+        flat = self.flat
+        return flat.height[self._index]
 
-    def _get_height(self) -> int:
-        """Calculates the height of the subtree recursively."""
-        if len(self.children) > 0:
-            return max(map(lambda n: n.height, self.children)) + 1
-        return 1
+    @property
+    def size(self) -> int:
+        """The number of nodes in the subtree."""
+        flat = self.flat
+        return flat.size[self._index]
 
     @property
-    def hash(self) -> str:
+    def hash(self) -> bytes:
         """A hash of this subtree. Allows for finding equal subtrees. This hash does NOT uniquely identify this node."""
         if self._hash is None:
-            hasher = hashlib.blake2b()
-            hasher.update(self._get_hash_str().encode())
-            self._hash = hasher.hexdigest()
+            # Calculate the hashes of the subtree bottom-up, as descendants succeed their ancestors in preorder
+            flat = self.flat
+            for i in reversed(flat.subtree(self._index)):
+                node = flat.nodes[i]
+                if node._hash is None:
+                    node._hash = node._get_hash()
         return self._hash
 
-    def _get_hash_str(self) -> str:
-        """Calculates the string used for calculating the hash recursively."""
-        if self._hash_str is None:
-            children = ''.join(map(Node._get_hash_str, self.children))
-            self._hash_str = f"{{{self.type}@{self.label}|{children}}}"
-        return self._hash_str
+    def _get_hash(self) -> bytes:
+        """
+        Calculates the hash of the subtree from the type and label of this node and the fixed-width hashes of its
+        children (a Merkle tree), so no representation of the whole subtree has to be built.
+        """
+        hasher = hashlib.blake2b(digest_size=self.hash_size)
+        hasher.update(self.type.encode())
+        # Separate the type from the label and distinguish an empty label from no label
+        hasher.update(b'\x00' if self.label is None else b'\x01' + self.label.encode())
+        hasher.update(b'\x00')
+        for child in self.children:
+            hasher.update(child.hash)
+        return hasher.digest()
 
-    def subtree(self, include_self: bool = True, reverse: bool = False) -> typing.Generator["Node", None, None]:
+    def subtree(self, include_self: bool = True, reverse: bool = False) -> typing.Iterator["Node"]:
         """
-        Returns a generator which yields the nodes in the subtree identified by this node. Allows for the subtree to be
+        Returns an iterator which yields the nodes in the subtree identified by this node. Allows for the subtree to be
         walked top-down or bottom-up (both depth-first). Optionally includes the current node in the iteration.
 
         :param include_self: Whether to include this node in the iteration.
         :param reverse: Whether to walk the subtree bottom-up instead of top-down.
-        :return: A generator which yields the nodes in this subtree.
+        :return: An iterator which yields the nodes in this subtree.
         """
-        return self._bottom_up_subtree(include_self) if reverse else self._top_down_subtree(include_self)
-
-    def _top_down_subtree(self, include_self: bool = True):
-        """Generator for traversing the subtree top-down."""
-        if include_self:
-            yield self
-
-        for child in self.children:
-            for node in child._top_down_subtree():
-                yield node
-
-    def _bottom_up_subtree(self, include_self: bool = True):
-        """Generator for traversing the subtree bottom-up."""
-        for child in self.children:
-            for node in child._bottom_up_subtree():
-                yield node
-
-        if include_self:
-            yield self
+        flat = self.flat
+        if reverse:
+            return map(flat.nodes.__getitem__, flat.reverse_subtree(self._index, include_self))
+        return map(flat.nodes.__getitem__, flat.subtree(self._index, include_self))
 
     def recursive_dependencies(self, exclude: typing.Optional[typing.List["Node"]] = None,
                                limit: typing.Optional[typing.Callable[[Dependency], bool]] = None,
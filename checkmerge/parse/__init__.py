@@ -1,3 +1,4 @@
+import io
 import typing
 
 from checkmerge.ir import tree
@@ -13,6 +14,21 @@ class ParseError(Exception):
         super(ParseError, self).__init__(message, *args)
 
 
+class Source(typing.NamedTuple):
+    """
+    Source code held in memory, such as a blob read from a version control system, along with the analysis
+    information for it. Parsers attribute the code to the given path, which does not need to exist.
+    """
+    #: The path the code is attributed to.
+    path: str
+    #: The code.
+    content: bytes
+    #: The contents of the analysis file for the code, if the parser requires one.
+    analysis: typing.Optional[bytes] = None
+    #: Other files held in memory that the code includes, as pairs of the path they are attributed to and their code.
+    headers: typing.Tuple[typing.Tuple[str, bytes], ...] = ()
+
+
 class Parser(object):
     """
     Abstract class for parser front ends of CheckMerge.
@@ -31,7 +47,9 @@ class Parser(object):
         """
         parse_func = None
 
-        if isinstance(obj, typing.IO):
+        if isinstance(obj, Source):
+            parse_func = self.parse_buffer
+        elif isinstance(obj, typing.IO):
             parse_func = self.parse_stream
         elif isinstance(obj, str):
             parse_func = self.parse_str
@@ -58,6 +76,15 @@ class Parser(object):
         """
         raise NotImplementedError()
 
+    def parse_buffer(self, source: Source) -> typing.List[tree.Node]:
+        """
+        Parses the code held in memory by the given source into CheckMerge IR.
+
+        :param source: The code to parse.
+        :return: The parsed IR.
+        """
+        return self.parse_stream(io.StringIO(str(source.content, 'utf-8')))
+
     def parse_file(self, path: str) -> typing.List[tree.Node]:
         """
         Parses the code in the file on the given path into CheckMerge IR.
@@ -67,3 +94,24 @@ class Parser(object):
         """
         with open(path) as file:
             return self.parse_stream(file)
+
+    def cache_key(self, path: typing.Union[str, Source]) -> typing.Optional[str]:
+        """
+        Returns a key identifying all inputs that determine the result of parsing the file on the given path, such as the
+        contents of the file and the configuration of the parser. Parsers that return `None` are never cached.
+
+        :param path: The file containing the code to parse, or the source held in memory.
+        :return: The key for caching the parsed IR, or `None` if the result should not be cached.
+        """
+        return None
+
+    def dependencies(self, path: typing.Union[str, Source]) -> typing.List[str]:
+        """
+        Returns the files other than the parsed file that the last parse of the file on the given path read, such as
+        included headers. Cached results are only reused while the contents of these files are unchanged, as they are
+        not part of the cache key.
+
+        :param path: The parsed file, or the parsed source held in memory.
+        :return: The paths of the files the parsed IR depends on.
+        """
+        return []
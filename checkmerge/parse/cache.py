@@ -0,0 +1,129 @@
+import hashlib
+import json
+import os
+import tempfile
+import typing
+
+from checkmerge import version
+from checkmerge.ir import serialize, tree
+from checkmerge.parse import Parser, Source
+
+
+class ParseCache(object):
+    """
+    Persistent, content-addressed cache of parsed IR trees.
+
+    Entries are keyed by the cache key of the parser (see `Parser.cache_key()`), which identifies all inputs of a parse,
+    combined with the versions of CheckMerge and the serialization format. Entries are therefore never invalidated
+    explicitly: a change to any of the inputs results in a different key.
+
+    Files that are only known once parsed, such as included headers (see `Parser.dependencies()`), are recorded in the
+    entry along with a digest of their contents. An entry is only used while all of them are unchanged.
+    """
+    #: The version of the layout of cache entries, which is increased on every incompatible change.
+    VERSION = 2
+
+    def __init__(self, directory: typing.Optional[str] = None):
+        """
+        :param directory: The directory to store the cache in. Defaults to `default_directory()`.
+        """
+        self.directory = directory or self.default_directory()
+
+    @staticmethod
+    def default_directory() -> str:
+        """The default cache directory, which follows the XDG base directory specification."""
+        base = os.environ.get('XDG_CACHE_HOME') or os.path.join(os.path.expanduser('~'), '.cache')
+        return os.path.join(base, 'checkmerge', 'parse')
+
+    @staticmethod
+    def key(parser_key: str) -> str:
+        """
+        :param parser_key: The cache key of the parser for the parsed input.
+        :return: The key of the cache entry.
+        """
+        h = hashlib.blake2b(digest_size=20)
+        h.update(repr((version.VERSION, version.BUILD, serialize.VERSION, ParseCache.VERSION)).encode('utf-8'))
+        h.update(b'\x00')
+        h.update(parser_key.encode('utf-8'))
+        return h.hexdigest()
+
+    def _path(self, key: str) -> str:
+        return os.path.join(self.directory, key[:2], key[2:])
+
+    @staticmethod
+    def digest(path: str) -> typing.Optional[str]:
+        """
+        :param path: The path of a file.
+        :return: The digest of the contents of the file, or `None` if it cannot be read.
+        """
+        try:
+            with open(path, 'rb') as f:
+                return hashlib.blake2b(f.read(), digest_size=20).hexdigest()
+        except OSError:
+            return None
+
+    def get(self, key: str) -> typing.Optional[typing.List[tree.Node]]:
+        """
+        :param key: The key of the cache entry.
+        :return: The cached trees, or `None` if there is no valid entry or one of its dependencies changed.
+        """
+        try:
+            with open(self._path(key), 'rb') as f:
+                dependencies = json.loads(f.readline())
+                if any(self.digest(path) != digest for path, digest in dependencies):
+                    return None
+                return serialize.loads(f.read())
+        except FileNotFoundError:
+            return None
+        except (OSError, ValueError, TypeError):
+            # Unreadable entries are treated as missing and will be overwritten
+            return None
+
+    def put(self, key: str, trees: typing.List[tree.Node], dependencies: typing.Iterable[str] = ()) -> None:
+        """
+        Stores trees in the cache. The entry is written atomically, so concurrent runs never read partial entries.
+
+        :param key: The key of the cache entry.
+        :param trees: The trees to store.
+        :param dependencies: The paths of the files other than the parsed file that the trees depend on.
+        """
+        manifest = [(path, self.digest(path)) for path in dependencies]
+        path = self._path(key)
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+
+        fd, tmp = tempfile.mkstemp(dir=os.path.dirname(path), prefix='.tmp-')
+        try:
+            with os.fdopen(fd, 'wb') as f:
+                f.write(json.dumps(manifest).encode('utf-8') + b'\n')
+                f.write(serialize.dumps(trees))
+            os.replace(tmp, path)
+        except BaseException:
+            os.unlink(tmp)
+            raise
+
+    def parse_file(self, parser: Parser, path: typing.Union[str, Source]) -> typing.List[tree.Node]:
+        """
+        Parses the file on the given path, using the cached result if one is available.
+
+        :param parser: The parser to use.
+        :param path: The file containing the code to parse, or the source held in memory.
+        :return: The parsed IR.
+        """
+        parse = parser.parse_buffer if isinstance(path, Source) else parser.parse_file
+        parser_key = parser.cache_key(path)
+
+        if parser_key is None:
+            return parse(path)
+
+        key = self.key(parser_key)
+        trees = self.get(key)
+
+        if trees is None:
+            trees = parse(path)
+            try:
+                self.put(key, trees, parser.dependencies(path))
+            except (OSError, TypeError):
+                # Caching is an optimization, an unwritable cache or unserializable trees should not fail the run
+                pass
+
+        return trees
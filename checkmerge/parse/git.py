@@ -0,0 +1,205 @@
+import linecache
+import os
+import posixpath
+import re
+import subprocess
+import typing
+
+from checkmerge.parse import ParseError, Source
+
+
+# Include directive of a header relative to the including file
+_quoted_include_re = re.compile(rb'^[ \t]*#[ \t]*include[ \t]*"([^"\n]+)"', re.MULTILINE)
+
+
+class GitRepository(object):
+    """
+    Reads the versions of files straight from the object database of a git repository, so no worktrees have to be
+    checked out. All objects are read through a single long-running `git cat-file --batch` process.
+
+    Analysis information is looked up by the hash of the blob of the source code, as it does not depend on the revision
+    the blob was found in. Analysis files are named after the blob hash followed by the extension of the analysis
+    format, in a directory given by the user. Analysis files committed next to the source are used otherwise.
+
+    Headers included with quotes are read from the same revision, so they do not depend on the work tree. Headers
+    included with angle brackets or found through include directories are read from disk as usual.
+    """
+
+    def __init__(self, path: str = '.', analysis_dir: typing.Optional[str] = None,
+                 analysis_extensions: typing.Sequence[str] = ('.ll.cmb', '.ll.cm'), git: str = 'git'):
+        """
+        :param path: A directory within the work tree or the git directory of the repository.
+        :param analysis_dir: The directory with the analysis files named after the blob hashes of the source code.
+        :param analysis_extensions: The extensions of analysis files in order of preference.
+        :param git: The git executable.
+        """
+        self.path = path
+        self.analysis_dir = analysis_dir
+        self.analysis_extensions = tuple(analysis_extensions)
+        self.git = git
+        self._batch: typing.Optional[subprocess.Popen] = None
+
+    def run(self, *args: str) -> str:
+        """
+        Runs a git command in the repository.
+
+        :param args: The arguments of the command.
+        :return: The output of the command without surrounding whitespace.
+        """
+        try:
+            result = subprocess.run([self.git, '-C', self.path, *args], stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                                    check=True)
+        except (OSError, subprocess.CalledProcessError) as e:
+            message = e.stderr.decode('utf-8', 'replace').strip() if isinstance(e, subprocess.CalledProcessError) else e
+            raise ParseError(f"Git command {' '.join(args)} failed: {message}")
+        return result.stdout.decode('utf-8').strip()
+
+    def merge_base(self, base: str, other: str) -> str:
+        """
+        :param base: The base revision.
+        :param other: The other revision.
+        :return: The hash of the best common ancestor of both revisions.
+        """
+        return self.run('merge-base', base, other)
+
+    def read(self, name: str) -> typing.Optional[typing.Tuple[str, bytes]]:
+        """
+        Reads an object from the object database.
+
+        :param name: The name of the object, such as `<revision>:<path>` or a hash.
+        :return: The hash and contents of the object, or `None` if the object does not exist.
+        """
+        if self._batch is None:
+            try:
+                self._batch = subprocess.Popen([self.git, '-C', self.path, 'cat-file', '--batch'],
+                                               stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+            except OSError as e:
+                raise ParseError(f"Unable to run git: {e}")
+
+        self._batch.stdin.write(name.encode('utf-8') + b'\n')
+        self._batch.stdin.flush()
+
+        header = self._batch.stdout.readline().split()
+        if len(header) != 3:
+            # The object is missing or the name is ambiguous
+            return None
+
+        content = self._batch.stdout.read(int(header[2]))
+        self._batch.stdout.read(1)
+        return header[0].decode('ascii'), content
+
+    def source(self, revision: str, path: str) -> Source:
+        """
+        Reads a file from a revision, with the analysis information for its blob and the headers it includes.
+
+        :param revision: The revision to read.
+        :param path: The path of the file relative to the root of the repository.
+        :return: The source held in memory, which is attributed to the given path prefixed with the revision.
+        """
+        blob = self.read(f'{revision}:{path}')
+        if blob is None:
+            raise ParseError(f"The file {path} does not exist in revision {revision}.", file=path)
+        blob_hash, content = blob
+
+        name = f'{revision}:{path}'
+        self._cache_lines(name, content)
+
+        return Source(name, content, self.analysis(revision, path, blob_hash), self.headers(revision, path, content))
+
+    def headers(self, revision: str, path: str, content: bytes) -> typing.Tuple[typing.Tuple[str, bytes], ...]:
+        """
+        Reads the headers that a file includes with quotes from a revision, including the headers they include.
+
+        Headers are attributed to the path a compiler looks them up at, which is the header name relative to the
+        directory of the path the including file is attributed to. For files at the root of the repository this is a
+        path relative to the working directory, which is not specific to the revision. Headers that do not exist in the
+        revision next to the including file are left out, so the compiler looks for them in its include directories.
+
+        :param revision: The revision to read.
+        :param path: The path of the including file relative to the root of the repository.
+        :param content: The code of the including file.
+        :return: The path each header is attributed to and its contents.
+        """
+        headers: typing.Dict[str, bytes] = {}
+        pending, expanded = [(f'{revision}:{path}', path, content)], {path}
+
+        while pending:
+            name, path, content = pending.pop()
+            for match in _quoted_include_re.finditer(content):
+                include = str(match.group(1), 'utf-8', 'replace')
+                header_path = posixpath.normpath(posixpath.join(posixpath.dirname(path), include))
+                header_name = posixpath.join(posixpath.dirname(name) or '.', include)
+                if header_name in headers or header_path.split('/', 1)[0] == '..' or posixpath.isabs(include):
+                    continue
+
+                blob = self.read(f'{revision}:{header_path}')
+                if blob is None:
+                    continue
+
+                headers[header_name] = blob[1]
+                if header_name.startswith(f'{revision}:'):
+                    self._cache_lines(header_name, blob[1])
+
+                # Headers including each other are followed once, as include guards stop the compiler as well
+                if header_path not in expanded:
+                    expanded.add(header_path)
+                    pending.append((header_name, header_path, blob[1]))
+
+        return tuple(sorted(headers.items()))
+
+    @staticmethod
+    def _cache_lines(name: str, content: bytes) -> None:
+        """Makes the code available for formatting reports, as the attributed path does not exist."""
+        linecache.cache[name] = (len(content), None, str(content, 'utf-8', 'replace').splitlines(True), name)
+
+    def analysis(self, revision: str, path: str, blob_hash: str) -> typing.Optional[bytes]:
+        """
+        Finds the analysis information for a blob, first in the analysis directory by the blob hash and then next to
+        the source in the revision.
+
+        :param revision: The revision the blob was read from.
+        :param path: The path of the blob in the revision.
+        :param blob_hash: The hash of the blob.
+        :return: The contents of the analysis file, or `None` if there is none.
+        """
+        if self.analysis_dir is not None:
+            for extension in self.analysis_extensions:
+                try:
+                    with open(os.path.join(self.analysis_dir, blob_hash + extension), 'rb') as f:
+                        return f.read()
+                except FileNotFoundError:
+                    continue
+
+        stem = path.rsplit('.', 1)[0]
+        for extension in self.analysis_extensions:
+            blob = self.read(f'{revision}:{stem}{extension}')
+            if blob is not None:
+                return blob[1]
+
+        return None
+
+    def merge_sources(self, base: str, other: str, path: str) -> typing.Tuple[Source, Source, Source]:
+        """
+        Reads the versions of a file for checking a merge of two revisions.
+
+        :param base: The base revision.
+        :param other: The other revision.
+        :param path: The path of the file relative to the root of the repository.
+        :return: The base, other and common ancestor versions of the file.
+        """
+        ancestor = self.merge_base(base, other)
+        return self.source(base, path), self.source(other, path), self.source(ancestor, path)
+
+    def close(self) -> None:
+        """Stops the process reading objects."""
+        if self._batch is not None:
+            self._batch.stdin.close()
+            self._batch.wait()
+            self._batch.stdout.close()
+            self._batch = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.close()
@@ -0,0 +1,89 @@
+import os
+import tempfile
+import unittest
+
+from checkmerge.ir.tree import Node
+from checkmerge.parse import Parser
+from checkmerge.parse.cache import ParseCache
+
+
+class CountingParser(Parser):
+    """Parser building a node per line that counts how often it parses."""
+    key = 'counting'
+
+    def __init__(self):
+        self.count = 0
+
+    def parse_stream(self, stream):
+        self.count += 1
+        return [Node("file", children=[Node("line", label=line.strip()) for line in stream])]
+
+    def cache_key(self, path):
+        with open(path) as f:
+            return f.read()
+
+
+class IncludingParser(CountingParser):
+    """Counting parser that depends on a header next to the parsed file."""
+    key = 'including'
+
+    def dependencies(self, path):
+        return [os.path.join(os.path.dirname(path), 'header.txt')]
+
+
+class ParseCacheTestCase(unittest.TestCase):
+    def setUp(self):
+        self.tmp = tempfile.TemporaryDirectory()
+        self.cache = ParseCache(os.path.join(self.tmp.name, 'cache'))
+        self.path = os.path.join(self.tmp.name, 'source.txt')
+        self.write("a\nb\n")
+
+    def tearDown(self):
+        self.tmp.cleanup()
+
+    def write(self, value):
+        with open(self.path, 'w') as f:
+            f.write(value)
+
+    def test_hit(self):
+        """Tests that unchanged inputs are served from the cache."""
+        parser = CountingParser()
+        first = self.cache.parse_file(parser, self.path)[0]
+        second = self.cache.parse_file(parser, self.path)[0]
+        self.assertEqual(1, parser.count)
+        self.assertIsNot(first, second)
+        self.assertEqual(first.hash, second.hash)
+
+    def test_miss(self):
+        """Tests that changed inputs and corrupt entries are parsed again."""
+        parser = CountingParser()
+        self.cache.parse_file(parser, self.path)
+        self.write("a\nc\n")
+        self.assertEqual(["a", "c"], [n.label for n in self.cache.parse_file(parser, self.path)[0].children])
+        self.assertEqual(2, parser.count)
+
+        with open(self.cache._path(ParseCache.key("a\nc\n")), 'wb') as f:
+            f.write(b'CMIR\x01garbage')
+        self.cache.parse_file(parser, self.path)
+        self.assertEqual(3, parser.count)
+
+    def test_dependencies(self):
+        """Tests that entries are parsed again when a file the parsed trees depend on changes."""
+        parser = IncludingParser()
+        header = os.path.join(self.tmp.name, 'header.txt')
+        with open(header, 'w') as f:
+            f.write("x\n")
+
+        self.cache.parse_file(parser, self.path)
+        self.cache.parse_file(parser, self.path)
+        self.assertEqual(1, parser.count)
+
+        with open(header, 'w') as f:
+            f.write("y\n")
+        self.cache.parse_file(parser, self.path)
+        self.cache.parse_file(parser, self.path)
+        self.assertEqual(2, parser.count)
+
+        os.unlink(header)
+        self.cache.parse_file(parser, self.path)
+        self.assertEqual(3, parser.count)
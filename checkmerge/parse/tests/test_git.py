@@ -0,0 +1,100 @@
+import os
+import shutil
+import subprocess
+import tempfile
+import unittest
+
+from checkmerge.parse import ParseError
+from checkmerge.parse.git import GitRepository
+
+
+@unittest.skipIf(shutil.which('git') is None, "Git is not available.")
+class GitRepositoryTestCase(unittest.TestCase):
+    def setUp(self):
+        self.tmp = tempfile.TemporaryDirectory()
+        self.repo = os.path.join(self.tmp.name, 'repo')
+        self.analysis_dir = os.path.join(self.tmp.name, 'analysis')
+        os.makedirs(self.repo)
+        os.makedirs(self.analysis_dir)
+
+        self.git('init', '-q')
+        self.git('symbolic-ref', 'HEAD', 'refs/heads/master')
+        self.commit('int main() { return 0; }\n')
+        self.git('branch', 'other')
+        self.commit('int main() { return 1; }\n', analysis='base analysis\n')
+        self.git('checkout', '-q', 'other')
+        self.commit('int main() { return 2; }\n')
+
+    def tearDown(self):
+        self.tmp.cleanup()
+
+    def git(self, *args):
+        subprocess.run(['git', '-C', self.repo, '-c', 'user.name=Test', '-c', 'user.email=test@example.com', *args],
+                       check=True, stdout=subprocess.DEVNULL)
+
+    def commit(self, code, analysis=None):
+        with open(os.path.join(self.repo, 'main.c'), 'w') as f:
+            f.write(code)
+        files = ['main.c']
+        if analysis is not None:
+            with open(os.path.join(self.repo, 'main.ll.cm'), 'w') as f:
+                f.write(analysis)
+            files.append('main.ll.cm')
+        self.git('add', *files)
+        self.git('commit', '-q', '-m', 'Change')
+
+    def test_merge_sources(self):
+        """Tests reading the versions of a file and their analysis information without a checkout."""
+        with GitRepository(self.repo, analysis_dir=self.analysis_dir) as git:
+            blob = git.run('rev-parse', 'other:main.c')
+            with open(os.path.join(self.analysis_dir, blob + '.ll.cmb'), 'wb') as f:
+                f.write(b'other analysis')
+
+            base, other, ancestor = git.merge_sources('master', 'other', 'main.c')
+
+        self.assertEqual(b'int main() { return 1; }\n', base.content)
+        self.assertEqual(b'int main() { return 2; }\n', other.content)
+        self.assertEqual(b'int main() { return 0; }\n', ancestor.content)
+        self.assertEqual(b'base analysis\n', base.analysis)
+        self.assertEqual(b'other analysis', other.analysis)
+        self.assertIsNone(ancestor.analysis)
+        self.assertEqual('master:main.c', base.path)
+
+    def test_missing_file(self):
+        """Tests that reading a file that does not exist is a parse error."""
+        with GitRepository(self.repo) as git:
+            with self.assertRaises(ParseError):
+                git.source('master', 'missing.c')
+
+    def test_headers(self):
+        """Tests that headers included with quotes are read from the revision and attributed to their lookup path."""
+        os.makedirs(os.path.join(self.repo, 'src', 'include'))
+        files = {
+            'src/main.c': '#include "include/a.h"\n#include <stdio.h>\n#include "missing.h"\n',
+            'src/include/a.h': '#include "../b.h"\n',
+            'src/b.h': '#include "include/a.h"\n',
+            'c.h': 'int c;\n',
+        }
+        for path, code in files.items():
+            with open(os.path.join(self.repo, path), 'w') as f:
+                f.write(code)
+        self.git('add', *files)
+        self.git('commit', '-q', '-m', 'Headers')
+
+        with open(os.path.join(self.repo, 'src', 'b.h'), 'w') as f:
+            f.write('work tree\n')
+        with open(os.path.join(self.repo, 'main.c'), 'w') as f:
+            f.write('#include "c.h"\n')
+        self.git('add', 'main.c')
+        self.git('commit', '-q', '-m', 'Include')
+
+        with GitRepository(self.repo) as git:
+            source = git.source('other~1', 'src/main.c')
+            root = git.source('other', 'main.c')
+
+        self.assertEqual((
+            ('other~1:src/include/../b.h', b'#include "include/a.h"\n'),
+            ('other~1:src/include/../include/a.h', b'#include "../b.h"\n'),
+            ('other~1:src/include/a.h', b'#include "../b.h"\n'),
+        ), source.headers)
+        self.assertEqual((('./c.h', b'int c;\n'),), root.headers)
@@ -1,8 +1,16 @@
-import typing
+from checkmerge import plugins
 
-from checkmerge import analysis, plugins
-from checkmerge.analysis.dependence import DependenceAnalysis
-from checkmerge.analysis.reference import ReferenceAnalysis
+
+#: Keys, names and descriptions of the provided analysis.
+DEPENDENCE_ANALYSIS = plugins.ClassInfo('dependence', "Dependence analysis",
+                                        "Finds changes in two versions that modify the same memory.")
+REFERENCE_ANALYSIS = plugins.ClassInfo('reference', "Reference analysis",
+                                       "Finds changes in versions that lead to broken references to identifiers.")
+
+#: Keys, names and descriptions of the provided diff algorithms.
+GUMTREE_DIFF = plugins.ClassInfo('gumtree', "GumTree", "Reference implementation of the GumTree tree diff algorithm.")
+SHARDED_DIFF = plugins.ClassInfo('sharded', "Sharded GumTree",
+                                 "GumTree tree diff of the changed top-level declarations, paired by their references.")
 
 
 class CheckMergePlugin(plugins.Plugin):
@@ -13,8 +21,12 @@ class CheckMergePlugin(plugins.Plugin):
     name = "CheckMerge"
     description = "The native CheckMerge plugin."
 
-    def provide_analysis(self) -> typing.List[typing.Type[analysis.Analysis]]:
-        return [
-            DependenceAnalysis,
-            ReferenceAnalysis,
-        ]
+    declared_analysis = [
+        plugins.Declaration.of('checkmerge.analysis.dependence:DependenceAnalysis', DEPENDENCE_ANALYSIS),
+        plugins.Declaration.of('checkmerge.analysis.reference:ReferenceAnalysis', REFERENCE_ANALYSIS),
+    ]
+
+    declared_diff_algorithms = [
+        plugins.Declaration.of('checkmerge.diff.gumtree:GumTreeDiff', GUMTREE_DIFF),
+        plugins.Declaration.of('checkmerge.diff.sharded:ShardedDiff', SHARDED_DIFF),
+    ]
@@ -3,7 +3,7 @@ import os
 import sys
 import typing
 
-from checkmerge import analysis, parse
+from checkmerge import analysis, diff, parse
 from checkmerge.util.registry import Registry
 
 
@@ -16,6 +16,149 @@ class KeyRegistry(Registry):
         return cls.key
 
 
+class ClassInfo(typing.NamedTuple):
+    """
+    The key, name and description of a class provided by a plugin. Plugins define these in a module that is imported
+    both by the class and by its declaration, so they are only written once (see `Declaration.of()`).
+    """
+    key: str
+    name: str
+    description: str
+
+
+class Declaration(object):
+    """
+    Declaration of a parser, analysis or diff algorithm provided by a plugin, by its key and the path to its class. The
+    module of the class is only imported, and the plugin only set up, once the class is looked up. The name and the
+    description are available without importing the class, and must match those of the class. The plugin is disabled
+    if they do not.
+    """
+    __slots__ = ('key', 'path', 'name', 'description', 'plugin')
+
+    def __init__(self, key: str, path: str, name: str = '', description: str = ''):
+        """
+        :param key: The key of the class.
+        :param path: The path to the class, as the name of its module and its name separated by a colon.
+        :param name: The human-readable name of the class.
+        :param description: The human-readable description of the class.
+        """
+        self.key = key
+        self.path = path
+        self.name = name
+        self.description = description
+        self.plugin: typing.Optional["Plugin"] = None
+
+    @classmethod
+    def of(cls, path: str, info: ClassInfo) -> "Declaration":
+        """
+        :param path: The path to the class, as the name of its module and its name separated by a colon.
+        :param info: The key, name and description that the class takes from the same `ClassInfo`.
+        :return: The declaration of the class.
+        """
+        return cls(info.key, path, info.name, info.description)
+
+    def resolve(self) -> typing.Optional[type]:
+        """
+        Imports the declared class, setting up its plugin first. Disables the plugin if the plugin cannot be set up,
+        the class cannot be imported or the class does not match its declaration.
+
+        :return: The declared class, or `None` if the plugin is disabled.
+        """
+        plugin = self.plugin
+        if plugin is not None and not plugin.ready and not plugin.disabled:
+            try:
+                plugin.setup()
+            except Exception as e:
+                plugin.disable(reason=str(e))
+        if plugin is not None and plugin.disabled:
+            return None
+
+        module, name = self.path.split(':')
+        try:
+            cls = getattr(importlib.import_module(module), name)
+        except (ImportError, AttributeError) as e:
+            if plugin is None:
+                raise
+            plugin.disable(reason=f"Unable to import {self.path}: {e}")
+            return None
+
+        if getattr(cls, 'key', None) != self.key:
+            reason = f"The class {self.path} does not have the declared key {self.key}."
+        elif (getattr(cls, 'name', ''), getattr(cls, 'description', '')) != (self.name, self.description):
+            reason = f"The class {self.path} does not have the declared name and description."
+        else:
+            return cls
+
+        if plugin is None:
+            raise ValueError(reason)
+        plugin.disable(reason=reason)
+        return None
+
+    def __repr__(self):
+        return f"<Declaration {self.key} {self.path}>"
+
+
+class LazyKeyRegistry(KeyRegistry):
+    """
+    Registry for classes with a `key` class parameter that also accepts declarations of classes, which are imported on
+    first lookup (see `Declaration`).
+    """
+
+    def __init__(self, base: typing.Type = object):
+        """
+        :param base: The class that registered and declared classes must be a subclass of.
+        """
+        super(LazyKeyRegistry, self).__init__()
+        self.base = base
+
+    def register(self, cls):
+        # A class replaces its declaration, while a declaration of a class that was imported already is ignored
+        existing = self.registry.get(self.key(cls))
+        if existing is not None and _path(existing) == _path(cls):
+            if isinstance(existing, Declaration):
+                self.registry[self.key(cls)] = cls
+            return
+        super(LazyKeyRegistry, self).register(cls)
+
+    def find(self, key: str) -> typing.Optional[type]:
+        item = self.registry.get(key, None)
+        if isinstance(item, Declaration):
+            item = self._resolve(item)
+        return item if self._filter(item) else None
+
+    def all(self) -> typing.List[type]:
+        """
+        Returns all usable registered classes, which imports all declared classes. Use `describe()` if only the keys,
+        names and descriptions are needed.
+        """
+        return list(filter(None, (self.find(key) for key in list(self.registry.keys()))))
+
+    def describe(self) -> typing.List[typing.Any]:
+        """
+        Returns the usable registered classes and the declarations of the classes that have not been imported yet,
+        without importing them. Both have a key, name and description.
+        """
+        return list(filter(self._filter, self.registry.values()))
+
+    def _resolve(self, declaration: Declaration) -> typing.Optional[type]:
+        cls = declaration.resolve()
+        if cls is None:
+            return None
+        assert issubclass(cls, self.base)
+        self.registry[declaration.key] = cls
+        return cls
+
+    def _filter(self, item) -> bool:
+        if isinstance(item, Declaration):
+            return item.plugin is None or not item.plugin.disabled
+        return item is not None
+
+
+def _path(item: typing.Union[type, Declaration]) -> str:
+    """The path to a class or a declared class, see `Declaration`."""
+    return item.path if isinstance(item, Declaration) else f"{item.__module__}:{item.__qualname__}"
+
+
 class PluginRegistry(KeyRegistry):
     """
     Manages the available CheckMerge plugins.
@@ -23,8 +166,9 @@ class PluginRegistry(KeyRegistry):
 
     def __init__(self):
         super(PluginRegistry, self).__init__()
-        self.parsers: Registry[str, parse.Parser] = KeyRegistry()
-        self.analysis: Registry[str, analysis.Analysis] = KeyRegistry()
+        self.parsers: LazyKeyRegistry = LazyKeyRegistry(parse.Parser)
+        self.analysis: LazyKeyRegistry = LazyKeyRegistry(analysis.Analysis)
+        self.diff: LazyKeyRegistry = LazyKeyRegistry(diff.DiffAlgorithm)
 
     def register(self, cls):
         # Register instance instead of class
@@ -34,10 +178,23 @@ class PluginRegistry(KeyRegistry):
         """
         Sets up the registered plugins. Marks plugins with errors as disabled. Registers functionality from the plugins
         in the appropriate sub registers.
+
+        Plugins declaring their functionality (see `Plugin.declared_parsers`) are not set up here. Their declarations
+        are registered instead, and the plugin is set up once one of its classes is looked up.
         """
         for plugin in self.registry.values():
             # Skip plugin if it is already loaded
-            if plugin.ready:
+            if plugin.ready or plugin.disabled:
+                continue
+
+            # Register declarations of lazily loaded plugins
+            if plugin.is_declarative:
+                for sub_registry, declarations in ((self.parsers, plugin.declared_parsers),
+                                                   (self.analysis, plugin.declared_analysis),
+                                                   (self.diff, plugin.declared_diff_algorithms)):
+                    for declaration in declarations:
+                        declaration.plugin = plugin
+                        sub_registry.register(declaration)
                 continue
 
             # Try to setup plugin, disable if an error occurs
@@ -54,6 +211,9 @@ class PluginRegistry(KeyRegistry):
                 for cls in plugin.provide_analysis():
                     assert issubclass(cls, analysis.Analysis)
                     self.analysis.register(cls)
+                for cls in plugin.provide_diff_algorithms():
+                    assert issubclass(cls, diff.DiffAlgorithm)
+                    self.diff.register(cls)
 
     def _filter(self, item: "Plugin") -> bool:
         return not item.disabled
@@ -105,14 +265,24 @@ class Plugin(object, metaclass=PluginBase):
     name: str = ''  # Human-readable name of the plugin
     description: str = ''  # Human-readable description of the plugin
 
+    # Declarations of the provided classes, which are imported on first use instead of when the plugin is set up
+    declared_parsers: typing.Sequence[Declaration] = ()
+    declared_analysis: typing.Sequence[Declaration] = ()
+    declared_diff_algorithms: typing.Sequence[Declaration] = ()
+
     def __init__(self):
         self._initialized: bool = False
         self._disabled: bool = False
         self._disable_reason: str = ''
 
+    @property
+    def is_declarative(self) -> bool:
+        """Whether the plugin declares the classes it provides, which are then loaded lazily."""
+        return bool(self.declared_parsers or self.declared_analysis or self.declared_diff_algorithms)
+
     def provide_parsers(self) -> typing.List[typing.Type[parse.Parser]]:
         """
-        Returns a list of the parsers provided by this plugin.
+        Returns a list of the parsers provided by this plugin. Not used if the plugin declares its classes.
 
         :return: The parsers provided by this plugin.
         """
@@ -120,12 +290,20 @@ class Plugin(object, metaclass=PluginBase):
 
     def provide_analysis(self) -> typing.List[typing.Type[analysis.Analysis]]:
         """
-        Returns a list of the analysis classes provided by this plugin.
+        Returns a list of the analysis classes provided by this plugin. Not used if the plugin declares its classes.
 
         :return: The analysis classes provided by this plugin.
         """
         return []
 
+    def provide_diff_algorithms(self) -> typing.List[typing.Type[diff.DiffAlgorithm]]:
+        """
+        Returns a list of the diff algorithms provided by this plugin. Not used if the plugin declares its classes.
+
+        :return: The diff algorithms provided by this plugin.
+        """
+        return []
+
     def setup(self):
         """
         Performs plugin initialization before it is used.
@@ -0,0 +1,94 @@
+import os
+import tempfile
+import unittest
+
+from checkmerge.analysis.dependence import DependenceAnalysis
+from checkmerge.app import CheckMerge, RunConfig
+from checkmerge.diff.gumtree import GumTreeDiff
+from checkmerge.ir.tree import Node
+from checkmerge.parse import Parser
+
+
+class IndentParser(Parser):
+    """Parser building a tree from the indentation of the lines in a file."""
+    key = 'indent'
+
+    def parse_stream(self, stream):
+        root = Node("file")
+        stack = [(-1, root)]
+        for line in stream:
+            depth = len(line) - len(line.lstrip())
+            while stack[-1][0] >= depth:
+                stack.pop()
+            stack.append((depth, Node("line", label=line.strip(), parent=stack[-1][1])))
+        return [root]
+
+
+def count_nodes(config, results):
+    """Batch report function returning the number of nodes of the base tree."""
+    return config.trees()[0].size
+
+
+class RunConfigTestCase(unittest.TestCase):
+    versions = (
+        "a\n b\n  c\n  d\ne\n f\n",
+        "a\n b\n  c\n  x\ne\n f\n g\n",
+        "a\n b\n  c\n  d\ne\n",
+    )
+
+    def setUp(self):
+        self.tmp = tempfile.TemporaryDirectory()
+        self.paths = []
+        for i, version in enumerate(self.versions):
+            self.paths.append(os.path.join(self.tmp.name, f'{i}.txt'))
+            with open(self.paths[-1], 'w') as f:
+                f.write(version)
+
+    def tearDown(self):
+        self.tmp.cleanup()
+
+    @staticmethod
+    def describe(result):
+        return sorted((n.index, m.index) for n, m in result.mapping.items())
+
+    def test_parallel(self):
+        """Tests that the parallel mode gives the same results as the sequential mode."""
+        sequential = RunConfig(IndentParser, GumTreeDiff, parallel=False).parse(*self.paths).diff().changes()
+        parallel = RunConfig(IndentParser, GumTreeDiff, parallel=True).parse(*self.paths).diff().changes()
+
+        self.assertEqual([n.label for n in sequential.base.subtree()], [n.label for n in parallel.base.subtree()])
+        for attr in ('_base_result', '_other_result'):
+            self.assertEqual(self.describe(getattr(sequential, attr)), self.describe(getattr(parallel, attr)))
+        self.assertEqual(self.describe(sequential), self.describe(parallel))
+
+    def test_batch(self):
+        """Tests that a batch run reports the results of every job."""
+        app = CheckMerge()
+        app._parser = IndentParser
+        jobs = [tuple(self.paths), (self.paths[1], self.paths[0], None)]
+
+        results = list(app.batch(jobs, [DependenceAnalysis], count_nodes, workers=2))
+
+        self.assertCountEqual(jobs, [r.job for r in results])
+        for result in results:
+            self.assertIsNone(result.error)
+            self.assertEqual(0, result.count)
+            self.assertEqual(RunConfig(IndentParser, GumTreeDiff).parse(*result.job).trees()[0].size,
+                             result.report)
+
+    def test_batch_failure(self):
+        """Tests that a failing job is reported with its error while the other jobs of the batch complete."""
+        app = CheckMerge()
+        app._parser = IndentParser
+        missing = os.path.join(self.tmp.name, 'missing.txt')
+        jobs = [tuple(self.paths), (self.paths[0], self.paths[1], missing), (self.paths[1], self.paths[0], None)]
+
+        results = {r.job: r for r in app.batch(jobs, [DependenceAnalysis], count_nodes, workers=2)}
+
+        self.assertCountEqual(jobs, results)
+        failed = results[jobs[1]]
+        self.assertIsNone(failed.report)
+        self.assertIn('FileNotFoundError', failed.error)
+        for job in (jobs[0], jobs[2]):
+            self.assertIsNone(results[job].error)
+            self.assertIsNotNone(results[job].report)
@@ -0,0 +1,54 @@
+import os
+import tempfile
+import unittest
+
+from click.testing import CliRunner
+
+from checkmerge import plugins
+from checkmerge.analysis.dependence import DependenceAnalysis
+from checkmerge.cli import cli, find_commands
+from checkmerge.diff.base import DiffAlgorithm, DiffResult
+from checkmerge.diff.sharded import ShardedDiff
+from checkmerge.tests import test_app
+from checkmerge.tests.test_app import IndentParser
+
+
+class RootDiff(DiffAlgorithm):
+    """Diff algorithm mapping the roots only, which does not support a budget."""
+    key = 'root'
+
+    def __call__(self, base, other, mapping=None):
+        return DiffResult(base, other, {base: other})
+
+
+class AnalyzeCommandTestCase(unittest.TestCase):
+    def setUp(self):
+        find_commands()
+        plugins.registry.parsers.register(IndentParser)
+        plugins.registry.diff.register(ShardedDiff)
+        plugins.registry.diff.register(RootDiff)
+        plugins.registry.analysis.register(DependenceAnalysis)
+
+        self.tmp = tempfile.TemporaryDirectory()
+        self.paths = []
+        for i, version in enumerate(test_app.RunConfigTestCase.versions):
+            self.paths.append(os.path.join(self.tmp.name, f'{i}.txt'))
+            with open(self.paths[-1], 'w') as f:
+                f.write(version)
+
+    def tearDown(self):
+        self.tmp.cleanup()
+
+    def analyze(self, *args):
+        return CliRunner().invoke(cli, ['analyze', '-p', 'indent', '-a', 'dependence', '--no-cache', *args,
+                                        *self.paths])
+
+    def test_budget(self):
+        """Tests that a budget is passed to diff algorithms supporting it and rejected for other algorithms."""
+        result = self.analyze('-d', 'sharded', '--diff-time-budget', '1', '--diff-work-budget', '100')
+        self.assertEqual(0, result.exit_code, result.output)
+
+        result = self.analyze('-d', 'root', '--diff-time-budget', '1')
+        self.assertNotEqual(0, result.exit_code)
+        self.assertIsInstance(result.exception, SystemExit)
+        self.assertIn("The diff algorithm 'root' does not support a budget.", result.output)
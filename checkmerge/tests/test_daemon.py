@@ -0,0 +1,108 @@
+import os
+import tempfile
+import threading
+import unittest
+
+from checkmerge import plugins
+from checkmerge.analysis.dependence import DependenceAnalysis
+from checkmerge.app import CheckMerge, RunConfig
+from checkmerge.daemon import Daemon, request
+from checkmerge.diff.gumtree import GumTreeDiff
+from checkmerge.tests import test_app
+from checkmerge.tests.test_app import IndentParser
+
+
+class DaemonTestCase(unittest.TestCase):
+    versions = test_app.RunConfigTestCase.versions
+
+    def setUp(self):
+        plugins.registry.parsers.register(IndentParser)
+        plugins.registry.diff.register(GumTreeDiff)
+        plugins.registry.analysis.register(DependenceAnalysis)
+
+        test_app.RunConfigTestCase.setUp(self)
+        app = CheckMerge()
+        app.set_options(cache=False)
+        self.daemon = Daemon(app, os.path.join(self.tmp.name, 'daemon.sock'))
+        self.request = {'command': 'analyze', 'parser': 'indent', 'diff': 'gumtree', 'analysis': ['dependence'],
+                        'versions': self.paths}
+
+    def tearDown(self):
+        self.tmp.cleanup()
+
+    def test_resident(self):
+        """Tests that unchanged programs are not parsed and diffed again."""
+        first = self.daemon.handle(self.request)
+        self.assertNotIn('error', first)
+        self.assertFalse(first['cached'])
+        trees = [entry[1] for entry in self.daemon.trees.values()]
+
+        second = self.daemon.handle(self.request)
+        self.assertTrue(second['cached'])
+        self.assertEqual([entry[1] for entry in self.daemon.trees.values()], trees)
+
+        # Change the other version, the diff of the base version against the ancestor is kept
+        base, other, ancestor = trees
+        base_result = self.daemon.diff_cache[(GumTreeDiff, ancestor, base, None)]
+        with open(self.paths[1], 'w') as f:
+            f.write("a\n b\n  y\ne\n")
+
+        third = self.daemon.handle(self.request)
+        self.assertFalse(third['cached'])
+        new_trees = [entry[1] for entry in self.daemon.trees.values()]
+        self.assertIs(base, new_trees[0])
+        self.assertIsNot(other, new_trees[1])
+        self.assertIs(base_result, self.daemon.diff_cache[(GumTreeDiff, ancestor, base, None)])
+        self.assertEqual(3, len(self.daemon.diff_cache))
+
+        # The result equals the result of a new run
+        expected = RunConfig(IndentParser, GumTreeDiff).parse(*self.paths).diff().changes()
+        describe = test_app.RunConfigTestCase.describe
+        self.assertEqual(describe(expected), describe(self.daemon.last[1].changes()))
+        self.assertIsNone(other.mapping)
+
+    def test_bounded(self):
+        """Tests that the least recently used trees are removed together with their diffs."""
+        self.daemon = Daemon(self.daemon.app, self.daemon.path, max_trees=3, max_diffs=3)
+        self.assertNotIn('error', self.daemon.handle(self.request))
+        first = [entry[1] for entry in self.daemon.trees.values()]
+
+        # A merge with two new versions replaces the two least recently used trees and their diffs
+        paths = []
+        for i, version in enumerate(("x\n y\n", "x\n z\n")):
+            paths.append(os.path.join(self.tmp.name, f'new-{i}.txt'))
+            with open(paths[-1], 'w') as f:
+                f.write(version)
+        self.assertNotIn('error', self.daemon.handle(dict(self.request, versions=[self.paths[2], *paths])))
+
+        self.assertEqual(3, len(self.daemon.trees))
+        trees = [entry[1] for entry in self.daemon.trees.values()]
+        self.assertIn(first[2], trees)
+        self.assertFalse(set(first[:2]) & set(trees))
+        self.assertTrue(all(set(key[1:4]) - {None} <= set(trees) for key in self.daemon.diff_cache))
+        self.assertLessEqual(len(self.daemon.diff_cache), 3)
+
+        with self.assertRaises(ValueError):
+            Daemon(self.daemon.app, self.daemon.path, max_trees=2)
+
+    def test_errors(self):
+        """Tests that invalid requests are reported."""
+        self.assertIn('error', self.daemon.handle({'command': 'unknown'}))
+        self.assertIn('error', self.daemon.handle(dict(self.request, parser='unknown')))
+        self.assertIn('error', self.daemon.handle(dict(self.request, versions=self.paths[:1])))
+
+    def test_serve(self):
+        """Tests requests over the socket."""
+        thread = threading.Thread(target=self.daemon.serve)
+        thread.start()
+        try:
+            for _ in range(100):
+                if os.path.exists(self.daemon.path):
+                    break
+                threading.Event().wait(0.01)
+            self.assertEqual([], request(self.daemon.path, self.request, timeout=10)['results'])
+            self.assertEqual(3, request(self.daemon.path, {'command': 'status'}, timeout=10)['trees'])
+        finally:
+            request(self.daemon.path, {'command': 'shutdown'}, timeout=10)
+            thread.join(10)
+        self.assertFalse(os.path.exists(self.daemon.path))
@@ -0,0 +1,59 @@
+import unittest
+
+from checkmerge import diff, plugins
+from checkmerge.diff.sharded import ShardedDiff
+from checkmerge.plugin import CheckMergePlugin
+
+
+class LazyKeyRegistryTestCase(unittest.TestCase):
+    def setUp(self):
+        self.plugin = plugins.Plugin()
+        self.registry = plugins.LazyKeyRegistry(diff.DiffAlgorithm)
+        self.declaration = plugins.Declaration('sharded', 'checkmerge.diff.sharded:ShardedDiff',
+                                               ShardedDiff.name, ShardedDiff.description)
+        self.declaration.plugin = self.plugin
+        self.registry.register(self.declaration)
+
+    def test_lazy(self):
+        """Tests that declared classes are only loaded and their plugin set up on lookup."""
+        self.assertEqual([self.declaration], self.registry.describe())
+        self.assertFalse(self.plugin.ready)
+
+        self.assertIs(ShardedDiff, self.registry.find('sharded'))
+        self.assertTrue(self.plugin.ready)
+        self.assertEqual([ShardedDiff], self.registry.describe())
+
+        # Declaring the imported class again keeps the class
+        self.registry.register(self.declaration)
+        self.assertIs(ShardedDiff, self.registry.find('sharded'))
+
+    def test_import_error(self):
+        """Tests that a plugin is disabled if a declared class cannot be imported."""
+        missing = plugins.Declaration('missing', 'checkmerge.diff.missing:MissingDiff')
+        missing.plugin = self.plugin
+        self.registry.register(missing)
+
+        self.assertIsNone(self.registry.find('missing'))
+        self.assertTrue(self.plugin.disabled)
+        self.assertEqual([], self.registry.all())
+
+    def test_mismatch(self):
+        """Tests that a plugin declaring a name or description other than that of the declared class is disabled."""
+        for name, description in (("GumTree", ShardedDiff.description), (ShardedDiff.name, "")):
+            plugin = plugins.Plugin()
+            registry = plugins.LazyKeyRegistry(diff.DiffAlgorithm)
+            declaration = plugins.Declaration('sharded', 'checkmerge.diff.sharded:ShardedDiff', name,
+                                              description)
+            declaration.plugin = plugin
+            registry.register(declaration)
+
+            self.assertIsNone(registry.find('sharded'))
+            self.assertTrue(plugin.disabled)
+            self.assertEqual([], registry.describe())
+
+    def test_metadata(self):
+        """Tests that the declarations of the default plugin match the declared classes."""
+        for declaration in (*CheckMergePlugin.declared_analysis, *CheckMergePlugin.declared_diff_algorithms):
+            cls = declaration.resolve()
+            self.assertEqual((cls.key, cls.name, cls.description),
+                             (declaration.key, declaration.name, declaration.description))
@@ -1,9 +1,12 @@
+import collections
 import heapq
 import typing
 
 
 # Type definitions
 T = typing.TypeVar('T')
+K = typing.TypeVar('K')
+V = typing.TypeVar('V')
 
 
 class PriorityList(object):
@@ -79,22 +82,116 @@ class PriorityList(object):
         return len(self.data)
 
 
+class LRUCache(typing.MutableMapping[K, V]):
+    """
+    Mapping holding a bounded number of items. Looking up or setting an item marks it as recently used, iterating over
+    the items does not. Adding an item to a full cache removes the least recently used item first.
+    """
+
+    def __init__(self, max_size: int, on_evict: typing.Optional[typing.Callable[[K, V], None]] = None):
+        """
+        :param max_size: The maximum number of items.
+        :param on_evict: Function called with the key and the value of every item removed to make room.
+        """
+        if max_size < 1:
+            raise ValueError("The maximum size of a cache must be positive.")
+        self.max_size = max_size
+        self.on_evict = on_evict
+        self._items: typing.OrderedDict[K, V] = collections.OrderedDict()
+
+    def __getitem__(self, key: K) -> V:
+        value = self._items[key]
+        self._items.move_to_end(key)
+        return value
+
+    def __setitem__(self, key: K, value: V) -> None:
+        self._items[key] = value
+        self._items.move_to_end(key)
+        while len(self._items) > self.max_size:
+            evicted = self._items.popitem(last=False)
+            if self.on_evict is not None:
+                self.on_evict(*evicted)
+
+    def __delitem__(self, key: K) -> None:
+        del self._items[key]
+
+    def __contains__(self, key: object) -> bool:
+        return key in self._items
+
+    def __iter__(self) -> typing.Iterator[K]:
+        return iter(self._items)
+
+    def __len__(self) -> int:
+        return len(self._items)
+
+    def items(self) -> typing.ItemsView[K, V]:
+        # Iterating over the items does not use them
+        return self._items.items()
+
+    def values(self) -> typing.ValuesView[V]:
+        return self._items.values()
+
+
 def remove_subsets(sets: typing.Iterable[typing.Set[T]]) -> typing.Iterable[typing.Set[T]]:
     """
     Removes sets that are identical to or a subset of another set in the provided iterable.
 
+    Sets are deduplicated and then visited from large to small, checking each set only against the remaining sets that
+    contain its rarest element, found through an inverted index. A 64-bit signature of element hashes rejects most
+    candidates without a full subset test. Being a subset is transitive, so removed sets need not be indexed.
+
     :param sets: An iterable containing the sets to make unique.
-    :return: The remaining sets.
+    :return: The remaining sets, in the order of their first occurrence.
     """
-    sets = list(sets)
-    result = set()
+    unique = list(dict.fromkeys(frozenset(s) for s in sets))
+    signatures = [_signature(s) for s in unique]
+
+    index: typing.Dict[T, typing.List[int]] = {}
+    keep = [False] * len(unique)
+    kept = 0
+
+    for k in sorted(range(len(unique)), key=lambda x: len(unique[x]), reverse=True):
+        s, signature = unique[k], signatures[k]
+
+        if not s:
+            # The empty set is a subset of any other set
+            keep[k] = kept == 0
+            continue
+
+        rarest = min(s, key=lambda e: len(index.get(e, ())))
+        keep[k] = not any(
+            signature & ~signatures[c] == 0 and len(unique[c]) > len(s) and s <= unique[c]
+            for c in index.get(rarest, ())
+        )
+
+        if keep[k]:
+            kept += 1
+            for e in s:
+                index.setdefault(e, []).append(k)
 
-    for s in sets:
-        y = [x for x in sets if s != x and s.issubset(x)]
-        if not y:
-            result.add(frozenset(s))
+    yield from (set(s) for k, s in enumerate(unique) if keep[k])
 
-    yield from (set(s) for s in result)
+
+def _signature(s: typing.AbstractSet[typing.Hashable]) -> int:
+    """The bitwise signature of a set, a subset sets no bits that are not set for its superset."""
+    signature = 0
+    for e in s:
+        signature |= 1 << (hash(e) & 63)
+    return signature
+
+
+def bitset(indices: typing.Iterable[int], size: int) -> int:
+    """
+    Builds a bitset as an integer in linear time, as setting the bits of an integer one by one copies it for each bit.
+
+    :param indices: The indices of the bits to set.
+    :param size: The number of bits of the bitset, which is larger than all indices.
+    :return: The bitset.
+    """
+    b = bytearray((size + 7) >> 3)
+    for i in indices:
+        b[i >> 3] |= 1 << (i & 7)
+    return int.from_bytes(b, 'little')
 
 
 def exists(iterable: typing.Iterable[T], pred: typing.Optional[typing.Callable[[T], bool]] = None):
@@ -0,0 +1,85 @@
+import typing
+
+
+# Type definitions
+PatternMasks = typing.Dict[str, int]
+
+
+def pattern_masks(pattern: str) -> PatternMasks:
+    """
+    Builds the match masks of a pattern for the bit-parallel algorithm: for every character of the pattern, the mask
+    has the bits set at the positions at which the character occurs.
+
+    :param pattern: The pattern.
+    :return: The masks by character.
+    """
+    masks: PatternMasks = {}
+    for i, c in enumerate(pattern):
+        masks[c] = masks.get(c, 0) | (1 << i)
+    return masks
+
+
+def _distance(masks: PatternMasks, m: int, text: str) -> int:
+    """
+    Computes the Levenshtein distance between a pattern, given by its match masks and its length, and a text.
+
+    This is the bit-parallel algorithm of Myers [1] in the formulation of Hyyrö [2] for the distance between complete
+    strings. A column of the dynamic programming matrix is encoded in bit vectors of its vertical deltas, which are
+    updated for every character of the text in a constant number of operations on integers as long as the pattern.
+
+    [1]: Myers. A Fast Bit-Vector Algorithm for Approximate String Matching Based on Dynamic Programming. 1999.
+    [2]: Hyyrö. Explaining and Extending the Bit-parallel Approximate String Matching Algorithm of Myers. 2001.
+    """
+    if m == 0:
+        return len(text)
+
+    full = (1 << m) - 1
+    last = 1 << (m - 1)
+    pv, mv, score = full, 0, m
+
+    for c in text:
+        eq = masks.get(c, 0)
+        xv = eq | mv
+        xh = (((eq & pv) + pv) ^ pv) | eq
+        ph = mv | (~(xh | pv) & full)
+        mh = pv & xh
+        if ph & last:
+            score += 1
+        elif mh & last:
+            score -= 1
+        # The first row of the matrix increases by one for every character of the text
+        ph = ((ph << 1) | 1) & full
+        mh = (mh << 1) & full
+        pv = mh | (~(xv | ph) & full)
+        mv = ph & xv
+
+    return score
+
+
+def distance(a: str, b: str) -> int:
+    """
+    Computes the Levenshtein distance between two strings, the minimum number of inserted, removed and replaced
+    characters to change one string into the other. The shorter string is encoded as the pattern.
+
+    :param a: The first string.
+    :param b: The second string.
+    :return: The distance between both strings.
+    """
+    if a == b:
+        return 0
+    if len(a) < len(b):
+        a, b = b, a
+    return _distance(pattern_masks(b), len(b), a)
+
+
+def distances(a: str, others: typing.Iterable[str]) -> typing.List[int]:
+    """
+    Computes the Levenshtein distances between a string and many other strings. The string is encoded as the pattern
+    once for all other strings.
+
+    :param a: The string.
+    :param others: The other strings.
+    :return: The distances between the string and each of the other strings.
+    """
+    masks, m = pattern_masks(a), len(a)
+    return [0 if a == b else _distance(masks, m, b) for b in others]
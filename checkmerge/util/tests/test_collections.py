@@ -1,6 +1,6 @@
 import unittest
 
-from checkmerge.util.collections import PriorityList
+from checkmerge.util.collections import LRUCache, PriorityList, bitset, remove_subsets
 
 
 class PriorityListTestCase(unittest.TestCase):
@@ -52,3 +52,47 @@ class PriorityListTestCase(unittest.TestCase):
         self.assertEqual(-1, pl.pop())
         self.assertFalse(pl)
         self.assertEqual(0, len(pl))
+
+
+class RemoveSubsetsTestCase(unittest.TestCase):
+    """
+    Test case for the removal of subsets.
+    """
+    def test_remove_subsets(self):
+        """Tests that duplicates and subsets are removed."""
+        sets = [{1, 2}, {1, 2, 3}, {4}, {2, 3}, {1, 2, 3}, {4, 5}, set(), {6}]
+        self.assertEqual([{1, 2, 3}, {4, 5}, {6}], list(remove_subsets(sets)))
+
+    def test_empty_set(self):
+        """Tests that the empty set is only kept when there are no other sets."""
+        self.assertEqual([set()], list(remove_subsets([set(), set()])))
+        self.assertEqual([], list(remove_subsets([])))
+
+
+class LRUCacheTestCase(unittest.TestCase):
+    """
+    Test case for the bounded cache.
+    """
+    def test_eviction(self):
+        """Tests that the least recently used items are removed once the cache is full."""
+        evicted = []
+        cache = LRUCache(2, on_evict=lambda k, v: evicted.append((k, v)))
+        cache['a'] = 1
+        cache['b'] = 2
+        self.assertEqual(1, cache['a'])
+        cache['c'] = 3
+
+        self.assertEqual([('b', 2)], evicted)
+        self.assertEqual(['a', 'c'], list(cache))
+        self.assertNotIn('b', cache)
+
+        del cache['a']
+        self.assertEqual({'c': 3}, dict(cache))
+
+
+class BitsetTestCase(unittest.TestCase):
+    def test_bitset(self):
+        """Tests that the bitset has exactly the given bits set."""
+        indices = [0, 7, 8, 63, 64, 1000]
+        self.assertEqual(sum(1 << i for i in indices), bitset(indices, 1001))
+        self.assertEqual(0, bitset([], 0))
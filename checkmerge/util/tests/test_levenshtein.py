@@ -0,0 +1,41 @@
+import random
+import unittest
+
+from checkmerge.util import levenshtein
+
+
+def wagner_fischer(a: str, b: str) -> int:
+    """Reference implementation of the Levenshtein distance."""
+    row = list(range(len(b) + 1))
+    for i, ca in enumerate(a, 1):
+        previous, row[0] = row[0], i
+        for j, cb in enumerate(b, 1):
+            previous, row[j] = row[j], min(row[j] + 1, row[j - 1] + 1, previous + (ca != cb))
+    return row[-1]
+
+
+class LevenshteinTestCase(unittest.TestCase):
+    """
+    Test case for the bit-parallel Levenshtein distance.
+    """
+    def setUp(self):
+        rnd = random.Random(0)
+        self.strings = [''.join(rnd.choice('abc ') for _ in range(rnd.randrange(100))) for _ in range(60)]
+
+    def test_distance(self):
+        """Tests the distance against the Wagner-Fischer algorithm, including patterns longer than a machine word."""
+        for a in self.strings:
+            for b in self.strings[:20]:
+                self.assertEqual(wagner_fischer(a, b), levenshtein.distance(a, b), (a, b))
+
+    def test_empty(self):
+        """Tests the distance to and from the empty string."""
+        self.assertEqual(0, levenshtein.distance('', ''))
+        self.assertEqual(3, levenshtein.distance('abc', ''))
+        self.assertEqual(3, levenshtein.distance('', 'abc'))
+        self.assertEqual([0, 3], levenshtein.distances('', ['', 'abc']))
+
+    def test_distances(self):
+        """Tests that the batched distances equal the single distances."""
+        for a in self.strings[:10]:
+            self.assertEqual([levenshtein.distance(a, b) for b in self.strings], levenshtein.distances(a, self.strings))
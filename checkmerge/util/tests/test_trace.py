@@ -0,0 +1,43 @@
+import unittest
+
+from checkmerge.util.trace import Tracer
+
+
+class TracerTestCase(unittest.TestCase):
+    """
+    Test case for the tracer.
+    """
+    def test_disabled(self):
+        """Tests that nothing is recorded while tracing is disabled."""
+        tracer = Tracer()
+        with tracer.span('work'):
+            tracer.count('items')
+
+        self.assertEqual([], tracer.events)
+        self.assertEqual({}, tracer.counters)
+
+    def test_spans_and_counters(self):
+        """Tests that nested spans and counters are recorded and exported."""
+        tracer = Tracer()
+        tracer.enable()
+
+        with tracer.span('outer', file='a.c'):
+            for _ in range(3):
+                with tracer.span('inner'):
+                    tracer.count('items', 2)
+
+        tracer.disable()
+        summary = tracer.summary()
+        trace = tracer.chrome_trace()
+
+        self.assertEqual(1, summary['spans']['outer']['count'])
+        self.assertEqual(3, summary['spans']['inner']['count'])
+        self.assertEqual({'items': 6}, summary['counters'])
+
+        events = trace['traceEvents']
+        self.assertEqual(['outer', 'inner', 'inner', 'inner', 'items'], [e['name'] for e in events])
+        self.assertEqual({'file': 'a.c'}, events[0]['args'])
+        for inner in events[1:4]:
+            self.assertGreaterEqual(inner['ts'], events[0]['ts'])
+            self.assertLessEqual(inner['ts'] + inner['dur'], events[0]['ts'] + events[0]['dur'])
+        self.assertEqual('C', events[-1]['ph'])
@@ -0,0 +1,137 @@
+import json
+import os
+import threading
+import time
+import typing
+from contextlib import contextmanager
+
+
+class Tracer(object):
+    """
+    Records nested spans of work and counters of the amount of work done, for finding out where the time of a run is
+    spent.
+
+    Tracing is disabled by default. Spans are then a shared no-op context manager and counting returns immediately, so
+    instrumentation can stay in place. Code in hot loops should check `enabled` before counting, or count in bulk.
+    The recorded data can be exported in the Chrome trace event format [1], which can be viewed in Perfetto or
+    `chrome://tracing`, and as a summary with the totals per span name and the counter values.
+
+    [1]: https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+    """
+
+    def __init__(self):
+        self.enabled = False
+        self.events: typing.List[typing.Dict[str, typing.Any]] = []
+        self.counters: typing.Dict[str, int] = {}
+        self._start = time.perf_counter()
+        self._lock = threading.Lock()
+
+    def enable(self) -> None:
+        """Enables tracing and discards any previously recorded data."""
+        self.reset()
+        self.enabled = True
+
+    def disable(self) -> None:
+        """Disables tracing. Recorded data is kept for exporting."""
+        self.enabled = False
+
+    def reset(self) -> None:
+        """Discards all recorded data."""
+        with self._lock:
+            self.events = []
+            self.counters = {}
+            self._start = time.perf_counter()
+
+    def span(self, name: str, **args: typing.Any) -> typing.ContextManager[None]:
+        """
+        Context manager recording the work within a `with` statement as a span. Spans nest by time.
+
+        :param name: The name of the span.
+        :param args: Additional information about the span, such as the processed file.
+        :return: The context manager.
+        """
+        if not self.enabled:
+            return _null_span
+        return self._span(name, args)
+
+    @contextmanager
+    def _span(self, name: str, args: typing.Dict[str, typing.Any]):
+        start = time.perf_counter()
+        try:
+            yield
+        finally:
+            end = time.perf_counter()
+            event = {
+                'name': name,
+                'ph': 'X',
+                'ts': (start - self._start) * 1e6,
+                'dur': (end - start) * 1e6,
+                'pid': os.getpid(),
+                'tid': threading.get_ident(),
+            }
+            if args:
+                event['args'] = {key: str(value) for key, value in args.items()}
+            with self._lock:
+                self.events.append(event)
+
+    def count(self, name: str, n: int = 1) -> None:
+        """
+        Increases a counter.
+
+        :param name: The name of the counter.
+        :param n: The amount to increase the counter with.
+        """
+        if self.enabled:
+            with self._lock:
+                self.counters[name] = self.counters.get(name, 0) + n
+
+    def summary(self) -> typing.Dict[str, typing.Any]:
+        """
+        :return: The number of occurrences and the total duration in seconds of the spans by name, and the counters.
+        """
+        spans: typing.Dict[str, typing.Dict[str, typing.Union[int, float]]] = {}
+        for event in self.events:
+            span = spans.setdefault(event['name'], {'count': 0, 'total': 0.0})
+            span['count'] += 1
+            span['total'] += event['dur'] / 1e6
+        return {'spans': spans, 'counters': dict(self.counters)}
+
+    def chrome_trace(self) -> typing.Dict[str, typing.Any]:
+        """
+        :return: The recorded data in the Chrome trace event format. Counters are added as counter events at the end of
+                 the trace and the summary is included as additional data.
+        """
+        end = max((e['ts'] + e['dur'] for e in self.events), default=0.0)
+        counters = [{'name': name, 'ph': 'C', 'ts': end, 'pid': os.getpid(), 'args': {name: value}}
+                    for name, value in sorted(self.counters.items())]
+        return {
+            'traceEvents': sorted(self.events, key=lambda e: e['ts']) + counters,
+            'displayTimeUnit': 'ms',
+            'otherData': self.summary(),
+        }
+
+    def write_chrome_trace(self, path: str) -> None:
+        """
+        Writes the recorded data in the Chrome trace event format to a file.
+
+        :param path: The path of the file.
+        """
+        with open(path, 'w') as f:
+            json.dump(self.chrome_trace(), f)
+
+
+class _NullSpan(object):
+    """Reusable context manager that does nothing, returned for spans while tracing is disabled."""
+    __slots__ = ()
+
+    def __enter__(self):
+        return None
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        return False
+
+
+_null_span = _NullSpan()
+
+#: The tracer of the process.
+tracer = Tracer()
@@ -1,31 +1,93 @@
+import bisect
 import collections
+import hashlib
 import os
-import queue
+import re
 import tempfile
 import typing
 
 import clang.cindex as clang
 
 from checkmerge import parse, ir
-from checkmerge_llvm import analysis as llvm
+from checkmerge_clang import plugin
+from checkmerge.util.trace import tracer
+from checkmerge_llvm import analysis as llvm, library as llvm_library
+
+
+class TokenTable(object):
+    """
+    Table of the tokens of a file, ordered by location, which allows looking up the tokens in a source range without
+    tokenizing the range again through libclang.
+    """
+    __slots__ = ('file', 'positions', 'spellings')
+
+    def __init__(self, tokens: typing.Iterable[clang.Token]):
+        """
+        :param tokens: The tokens of a single file in order of appearance.
+        """
+        self.file: typing.Optional[str] = None
+        self.positions: typing.List[typing.Tuple[int, int]] = []
+        self.spellings: typing.List[str] = []
+
+        for token in tokens:
+            location = token.location
+            if self.file is None:
+                self.file = location.file.name if location.file is not None else ''
+            self.positions.append((location.line, location.column))
+            self.spellings.append(token.spelling)
+
+    def span(self, extent: clang.SourceRange) -> typing.Optional[range]:
+        """
+        Returns the indices of the tokens starting in the given range.
+
+        :param extent: The source range.
+        :return: The indices in the table, or `None` if the range is not in the file of this table.
+        """
+        start, end = extent.start, extent.end
+        if start.file is None or start.file.name != self.file:
+            return None
+        return range(bisect.bisect_left(self.positions, (start.line, start.column)),
+                     bisect.bisect_left(self.positions, (end.line, end.column)))
+
+    def tokens(self, cursor: clang.Cursor) -> typing.List[typing.Tuple[int, int, str]]:
+        """
+        Returns the line, column and spelling of the tokens of the given cursor. Cursors outside of the file of this
+        table are tokenized through libclang.
+
+        :param cursor: The cursor to get the tokens for.
+        :return: The tokens of the cursor in order of appearance.
+        """
+        span = self.span(cursor.extent)
+        if span is None:
+            return [(t.location.line, t.location.column, t.spelling) for t in cursor.get_tokens()]
+        return [(*self.positions[i], self.spellings[i]) for i in span]
 
 
 # Customizer type definition
 NodeData = typing.Dict[str, typing.Any]
-Customizer = typing.Callable[[clang.Cursor, NodeData], NodeData]
+Customizer = typing.Callable[[clang.Cursor, NodeData, TokenTable], NodeData]
 
 
 class ClangParser(parse.Parser):
     """
     A CheckMerge parser using the Clang compiler.
 
-    As Clang only works with files it is recommended to use parsing from file for efficiency reasons. The other parse
-    methods have been implemented to use a temporary file. Therefore, using `parse_stream` with a source file would mean
-    a lot of unnecessary IO overhead.
+    The LLVM static analysis of the code is read from the analysis file next to the code, which is written by running
+    the LLVM pass through `opt`. Optionally, the analysis is run within this process through a CheckMerge-LLVM library
+    providing its C API (see `llvm_library.Library`), which has to be configured explicitly.
+
+    Code held in memory (see `parse.Source`) is passed to libclang as an unsaved file, so no temporary files are
+    written. The headers held in memory along with the code are passed as unsaved files as well, and take precedence
+    over the headers on disk. The analysis information for such code is either held in memory as well, analyzed in
+    memory by the library, or read from the analysis file for the path the code is attributed to. The library reads
+    included headers from disk, so code with headers held in memory is not cached when it is analyzed by the library.
+
+    A parser instance keeps a single libclang index for all files it parses. Optionally, the headers included at the
+    start of a file are precompiled, and the precompiled header is reused for every file that includes headers with the
+    same contents. Declarations loaded from a precompiled header are not part of the IR tree of a file, so this option
+    should only be used when changes to the headers themselves are not of interest.
     """
-    key = 'clang'
-    name = 'Clang'
-    description = 'Parser using the Clang compiler. See documentation for specific requirements.'
+    key, name, description = plugin.CLANG_PARSER
 
     # Empty list for efficiency purposes
     empty_set: typing.Set[None] = set()
@@ -36,51 +98,303 @@ class ClangParser(parse.Parser):
     # Clang args
     _clang_args = []
 
-    def parse_str(self, val: str) -> typing.List[ir.Node]:
-        # Create temporary file to work with
-        with tempfile.NamedTemporaryFile() as f:
-            # Write string to file
-            f.write(val)
+    # Path that code given as string or stream is attributed to
+    _buffer_name = 'input.c'
 
-            # Parse from file
-            return self.parse_file(f.name)
+    # Include directive at the start of a file
+    _include_re = re.compile(r'^\s*#\s*include\s*([<"])([^>"]+)[>"]')
+
+    def __init__(self, precompile_headers: bool = False, pch_dir: typing.Optional[str] = None,
+                 analysis_library_path: typing.Optional[str] = None):
+        """
+        :param precompile_headers: Whether to precompile and share the headers included at the start of parsed files,
+                                   which leaves their declarations out of the IR.
+        :param pch_dir: The directory to store precompiled headers in. Defaults to a temporary directory that lives as
+                        long as this parser.
+        :param analysis_library_path: The path of the CheckMerge-LLVM library to run the LLVM analysis with in this
+                                      process, or `None` to read analysis files.
+        """
+        self.precompile_headers = precompile_headers
+        self.analysis_library_path = analysis_library_path
+        self._pch_dir = pch_dir
+        self._tmp_dir: typing.Optional[tempfile.TemporaryDirectory] = None
+        self._index: typing.Optional[clang.Index] = None
+        self._pch: typing.Dict[str, typing.Optional[str]] = {}
+        self._pch_headers: typing.Dict[str, typing.List[str]] = {}
+        self._includes: typing.Dict[str, typing.List[str]] = {}
+
+    @property
+    def index(self) -> clang.Index:
+        """The libclang index shared by all parses of this parser."""
+        if self._index is None:
+            self._index = clang.Index.create()
+        return self._index
+
+    def parse_str(self, val: typing.AnyStr) -> typing.List[ir.Node]:
+        return self.parse_buffer(parse.Source(self._buffer_name, val.encode('utf-8') if isinstance(val, str) else val))
 
     def parse_stream(self, stream: typing.IO) -> typing.List[ir.Node]:
-        # Create temporary file to work with
-        with tempfile.NamedTemporaryFile() as f:
-            # Write string to file
-            f.write(stream.read())
+        return self.parse_str(stream.read())
 
-            # Parse from file
-            return self.parse_file(f.name)
+    @property
+    def analysis_library(self) -> typing.Optional[llvm_library.Library]:
+        """The CheckMerge-LLVM library running the analysis, or `None` if analysis files are read instead."""
+        if self.analysis_library_path is None:
+            return None
+        try:
+            return llvm_library.load_library(self.analysis_library_path)
+        except EnvironmentError as e:
+            raise parse.ParseError(str(e))
 
-    def parse_file(self, path: str) -> typing.List[ir.Node]:
-        # Create index for parsing
-        index = clang.Index.create()
+    def parse_buffer(self, source: parse.Source) -> typing.List[ir.Node]:
+        # Without analysis information in memory, analyze the source or look for an analysis file for its path
+        if source.analysis is None:
+            return self._parse(source.path, source.content, lambda: self._analyze(source.path, source.content),
+                               source.headers)
+
+        def read_analysis() -> typing.Set[llvm.AnalysisNode]:
+            try:
+                return llvm.parse_bytes(source.analysis)
+            except ValueError as e:
+                raise parse.ParseError(f"Unable to parse the analysis for {source.path}. {e}")
 
+        return self._parse(source.path, source.content, read_analysis, source.headers)
+
+    def parse_file(self, path: str) -> typing.List[ir.Node]:
         # Check if file exists
         if not os.path.isfile(path):
             raise parse.ParseError(f"The file {path} does not exist.")
 
+        return self._parse(path, None, lambda: self._analyze(path))
+
+    def _parse(self, path: str, content: typing.Optional[bytes],
+               read_analysis: typing.Callable[[], typing.Set[llvm.AnalysisNode]],
+               headers: typing.Sequence[typing.Tuple[str, bytes]] = ()) -> typing.List[ir.Node]:
+        """
+        Parses a file, or code held in memory that is passed to libclang as an unsaved file with the given path.
+
+        :param path: The path of the file.
+        :param content: The code, or `None` to read the code from the file.
+        :param read_analysis: Function returning the LLVM static analysis results for the code.
+        :param headers: The headers held in memory, which are passed to libclang as unsaved files.
+        :return: The parsed IR.
+        """
+        args = list(self._clang_args)
+
+        includes = set()
+
+        # Use precompiled headers if enabled and available, which are built from the headers on disk
+        if self.precompile_headers and not headers:
+            pch = self.get_precompiled_header(path, content)
+            if pch is not None:
+                args.extend(('-include-pch', pch))
+                includes.update(self._pch_headers.get(pch, ()))
+
         # Try if parsing the code is successful
         try:
-            tu = index.parse(path=path, args=self._clang_args)
+            unsaved_files = [(path, content)] if content is not None else []
+            unsaved_files.extend(headers)
+            tu = self.index.parse(path=path, args=args, unsaved_files=unsaved_files or None)
         except clang.TranslationUnitLoadError:
             raise parse.ParseError(f"Unable to parse {path}. Run your compiler and check for errors.")
 
-        # Get LLVM static analysis results
+        # Declarations from headers are part of the IR, so record the headers on disk the code depends on
+        includes.update(os.path.abspath(i.include.name) for i in tu.get_includes())
+        includes.difference_update(os.path.abspath(name) for name, _ in headers)
+        self._includes[path] = sorted(includes)
+
+        return [self.walk_ast(tu.cursor, read_analysis())]
+
+    def _analyze(self, path: str, content: typing.Optional[bytes] = None) -> typing.Set[llvm.AnalysisNode]:
+        """Runs the LLVM static analysis on a file or code held in memory, or reads it from the analysis file."""
+        library = self.analysis_library
+        if library is None:
+            return self._read_analysis(path)
+
+        with tracer.span('llvm.analyze', file=path):
+            try:
+                return library.analyze(path, content, self._clang_args)
+            except llvm_library.LibraryError as e:
+                raise parse.ParseError(f"Unable to analyze {path}. {e}")
+            except ValueError as e:
+                raise parse.ParseError(f"Unable to parse the analysis of {path}. {e}")
+
+    @staticmethod
+    def _read_analysis(path: str) -> typing.Set[llvm.AnalysisNode]:
+        """Reads the LLVM static analysis results from the analysis file for the file on the given path."""
         analysis_path = llvm.get_analysis_file(path)
 
         try:
-            with open(analysis_path) as analysis_file:
-                analysis = llvm.AnalysisParser.parse(analysis_file)
+            return llvm.parse_file(analysis_path)
         except FileNotFoundError:
             raise parse.ParseError(f"The analysis file {analysis_path} for {path} does not exist.")
         except IOError:
             raise parse.ParseError(f"Unable to parse analysis file {analysis_path} for {path}."
                                    f"An error occured while reading the file.")
+        except ValueError as e:
+            raise parse.ParseError(f"Unable to parse analysis file {analysis_path} for {path}. {e}")
+
+    def get_precompiled_header(self, path: str, content: typing.Optional[bytes] = None) -> typing.Optional[str]:
+        """
+        Returns a precompiled header for the headers included at the start of the given file. Precompiled headers are
+        shared between files that include the same headers with the same contents, and are built on first use.
+
+        :param path: The file containing the code to parse.
+        :param content: The code held in memory for the file, or `None` to read the file.
+        :return: The path of the precompiled header, or `None` if the file does not start with includes or the headers
+                 could not be precompiled.
+        """
+        includes = self._read_includes(path, content)
+        if not includes:
+            return None
+
+        # Identify the headers by their contents, headers that cannot be found are identified by their name
+        h = hashlib.blake2b(digest_size=20)
+        h.update(repr((self._clang_args, os.path.splitext(path)[1])).encode('utf-8'))
+        lines, headers = [], []
+        for quoted, name in includes:
+            header = self._find_header(name, os.path.dirname(os.path.abspath(path)) if quoted else None)
+            if header is None:
+                lines.append(f'#include <{name}>' if not quoted else f'#include "{name}"')
+                h.update(lines[-1].encode('utf-8'))
+            else:
+                lines.append(f'#include "{header}"')
+                headers.append(header)
+                with open(header, 'rb') as f:
+                    h.update(hashlib.blake2b(f.read(), digest_size=20).digest())
+            h.update(b'\x00')
+        key = h.hexdigest()
+
+        if key not in self._pch:
+            self._pch[key] = self._build_precompiled_header(key, lines, path)
+            if self._pch[key] is not None:
+                self._pch_headers[self._pch[key]] = headers
+        return self._pch[key]
+
+    def _build_precompiled_header(self, key: str, lines: typing.List[str], path: str) -> typing.Optional[str]:
+        """Precompiles a header consisting of the given include directives."""
+        if self._pch_dir is None:
+            self._tmp_dir = self._tmp_dir or tempfile.TemporaryDirectory(prefix='checkmerge-pch-')
+            directory = self._tmp_dir.name
+        else:
+            directory = self._pch_dir
+            os.makedirs(directory, exist_ok=True)
+
+        header, pch = os.path.join(directory, f'{key}.h'), os.path.join(directory, f'{key}.pch')
+
+        # Precompiled headers in a persistent directory can be reused by other parsers
+        if os.path.isfile(pch):
+            return pch
+
+        with open(header, 'w') as f:
+            f.write('\n'.join(lines) + '\n')
+
+        language = 'c++-header' if os.path.splitext(path)[1] in ('.cc', '.cpp', '.cxx', '.hpp') else 'c-header'
+
+        try:
+            tu = self.index.parse(path=header, args=[*self._clang_args, '-x', language,
+                                                     f'-I{os.path.dirname(os.path.abspath(path))}'])
+            tu.save(pch)
+        except (clang.TranslationUnitLoadError, clang.TranslationUnitSaveError):
+            # Files are parsed without precompiled header
+            return None
+
+        return pch
+
+    @classmethod
+    def _read_includes(cls, path: str, content: typing.Optional[bytes] = None) -> typing.List[typing.Tuple[bool, str]]:
+        """
+        Reads the include directives at the start of a file, before any other code except comments.
+
+        :param path: The file to read.
+        :param content: The code held in memory for the file, or `None` to read the file.
+        :return: Whether the header name is quoted and the header name for each include directive.
+        """
+        includes = []
+        comment = False
+
+        if content is not None:
+            lines = str(content, 'utf-8', errors='replace').splitlines()
+        else:
+            with open(path, errors='replace') as f:
+                lines = f.readlines()
+
+        for line in lines:
+            stripped = line.strip()
+
+            # Skip comments
+            if comment:
+                comment = '*/' not in stripped
+                continue
+            if not stripped or stripped.startswith('//'):
+                continue
+            if stripped.startswith('/*'):
+                comment = '*/' not in stripped
+                continue
+
+            match = cls._include_re.match(stripped)
+            if match is None:
+                break
+            includes.append((match.group(1) == '"', match.group(2)))
 
-        return [self.walk_ast(tu.cursor, analysis)]
+        return includes
+
+    def _find_header(self, name: str, directory: typing.Optional[str]) -> typing.Optional[str]:
+        """Finds a header in the given directory or the include directories passed to Clang."""
+        directories = [directory] if directory is not None else []
+        directories.extend(arg[2:] for arg in self._clang_args if arg.startswith('-I') and len(arg) > 2)
+
+        for d in directories:
+            candidate = os.path.join(d, name)
+            if os.path.isfile(candidate):
+                return os.path.abspath(candidate)
+        return None
+
+    def cache_key(self, path: typing.Union[str, parse.Source]) -> typing.Optional[str]:
+        # The result depends on the source, the analysis results and the arguments passed to Clang
+        h = hashlib.blake2b(digest_size=20)
+        h.update(repr((self.key, self._clang_args, self.precompile_headers)).encode('utf-8'))
+
+        # Analysis run by the library depends on the library instead of an analysis file
+        try:
+            library = self.analysis_library
+        except parse.ParseError:
+            return None
+        if library is not None:
+            try:
+                stat = os.stat(library.path)
+            except OSError:
+                return None
+            h.update(repr((library.path, stat.st_size, stat.st_mtime_ns)).encode('utf-8'))
+
+        if isinstance(path, parse.Source):
+            # The library reads the headers from disk rather than the headers held in memory
+            if path.headers and library is not None:
+                return None
+            h.update(repr((path.path, [name for name, _ in path.headers])).encode('utf-8'))
+            contents = [path.content] + [content for _, content in path.headers]
+            contents.extend([path.analysis] if path.analysis is not None else [])
+            files = [] if path.analysis is not None or library is not None else [llvm.get_analysis_file(path.path)]
+        else:
+            contents, files = [], [path] + ([llvm.get_analysis_file(path)] if library is None else [])
+
+        try:
+            for file in files:
+                with open(file, 'rb') as f:
+                    contents.append(f.read())
+        except OSError:
+            # Let the parser report missing or unreadable files
+            return None
+
+        for content in contents:
+            h.update(b'\x00')
+            h.update(hashlib.blake2b(content, digest_size=20).digest())
+
+        return h.hexdigest()
+
+    def dependencies(self, path: typing.Union[str, parse.Source]) -> typing.List[str]:
+        # The headers included by the translation unit, including those read from a precompiled header
+        return list(self._includes.get(path.path if isinstance(path, parse.Source) else path, ()))
 
     def walk_ast(self, cursor: clang.Cursor, analysis: typing.Iterable[llvm.AnalysisNode]) -> ir.Node:
         """
@@ -99,8 +413,11 @@ class ClangParser(parse.Parser):
             else:
                 analysis_lookup[None].add(a)
 
-        # Queue
-        walk_queue = queue.LifoQueue()
+        # Tokenize the file once for all customizers
+        tokens = TokenTable(cursor.get_tokens())
+
+        # Stack of cursors to visit
+        stack: typing.List[typing.Tuple[clang.Cursor, typing.Optional[ir.Node]]] = []
 
         # Mapping of declarations (functions, types, ...)
         mapping: typing.Dict[clang.Cursor, ir.Node] = {}
@@ -109,54 +426,53 @@ class ClangParser(parse.Parser):
         DependencyCache = typing.Dict[ir.Node, typing.Set[typing.Tuple[clang.Cursor, ir.DependencyType]]]
         dependencies: DependencyCache = collections.defaultdict(set)
 
-        # Add first element to queue
-        walk_queue.put((cursor, None))
+        # Add first element to stack
+        stack.append((cursor, None))
 
         root = None
+        created = 0
 
         # Walk the AST and create the IR tree
-        while True:
-            try:
-                cursor, parent = walk_queue.get_nowait()
+        while stack:
+            cursor, parent = stack.pop()
 
-                # Build IR node from cursor
-                node = self.parse_clang_node(cursor, parent)
+            # Build IR node from cursor
+            node = self.parse_clang_node(cursor, parent, tokens)
+            created += 1
 
-                # Set as root if appropriate
-                if root is None:
-                    root = node
+            # Set as root if appropriate
+            if root is None:
+                root = node
 
-                # Add reference dependencies if appropriate
-                dependencies[node].update(((d.canonical.hash, ir.DependencyType.REFERENCE)
-                                           for d in self.get_references(cursor)))
+            # Add reference dependencies if appropriate
+            dependencies[node].update(((d.canonical.hash, ir.DependencyType.REFERENCE)
+                                       for d in self.get_references(cursor)))
 
-                # Add arguments of calls and function definitions as dependency
-                dependencies[node].update(((d.canonical.hash, ir.DependencyType.ARGUMENT)
-                                           for d in self.get_arguments(cursor)))
+            # Add arguments of calls and function definitions as dependency
+            dependencies[node].update(((d.canonical.hash, ir.DependencyType.ARGUMENT)
+                                       for d in self.get_arguments(cursor)))
 
-                # Map cursor to node for dependency resolving
-                mapping[cursor.canonical.hash] = node
+            # Map cursor to node for dependency resolving
+            mapping[cursor.canonical.hash] = node
 
-                alt_location = ir.Location(node.location.file, node.location.line, node.location.column + node.label.find(': ') + 1)
-                analysis_nodes = analysis_lookup.get(node.location, self.empty_set).copy()
+            alt_location = ir.Location(node.location.file, node.location.line, node.location.column + node.label.find(': ') + 1)
+            analysis_nodes = analysis_lookup.get(node.location, self.empty_set).copy()
 
-                for analysis_node in analysis_lookup.get(alt_location, self.empty_set):
-                    analysis_nodes.add(analysis_node)
+            for analysis_node in analysis_lookup.get(alt_location, self.empty_set):
+                analysis_nodes.add(analysis_node)
 
-                # Find analysis info
-                for analysis_node in analysis_nodes:
-                    # Map analysis node to IR node for resolving references
-                    mapping[analysis_node] = node
+            # Find analysis info
+            for analysis_node in analysis_nodes:
+                # Map analysis node to IR node for resolving references
+                mapping[analysis_node] = node
 
-                    # Add dependencies
-                    dependencies[node].update(analysis_node.dependencies)
+                # Add dependencies
+                dependencies[node].update(analysis_node.dependencies)
 
-                # Add children to queue
-                for child in reversed(list(cursor.get_children())):
-                    walk_queue.put_nowait((child, node))
-            except queue.Empty:
-                # Break out of loop when the queue is empty
-                break
+            # Add children to stack
+            stack.extend((child, node) for child in reversed(list(cursor.get_children())))
+
+        tracer.count('clang.nodes', created)
 
         # Resolve dependencies
         for node, deps in dependencies.items():
@@ -171,12 +487,14 @@ class ClangParser(parse.Parser):
         return root
 
     @classmethod
-    def parse_clang_node(cls, cursor: clang.Cursor, parent: typing.Optional[ir.Node] = None) -> ir.Node:
+    def parse_clang_node(cls, cursor: clang.Cursor, parent: typing.Optional[ir.Node] = None,
+                         tokens: typing.Optional[TokenTable] = None) -> ir.Node:
         """
         Parses a Clang AST node identified by a cursor into an IR node.
 
         :param cursor: The cursor pointing to the node.
         :param parent: The parent IR node.
+        :param tokens: The tokens of the file of the node, the node is tokenized separately if not provided.
         :return: The corresponding IR node.
         """
         type_str = getattr(cursor.type, 'spelling', '')
@@ -199,7 +517,7 @@ class ClangParser(parse.Parser):
 
         # Overrides for specific kinds of nodes
         if cursor.kind in cls._customizers:
-            cls._customizers[cursor.kind](cursor, kwargs)
+            cls._customizers[cursor.kind](cursor, kwargs, tokens if tokens is not None else TokenTable(()))
 
         # Build node
         node = ir.Node(**kwargs)
@@ -283,7 +601,7 @@ class ClangParser(parse.Parser):
 
 
 @ClangParser.register_customizer(clang.CursorKind.TYPEDEF_DECL)
-def customize_typedef_decl(cursor: clang.Cursor, kwargs: NodeData) -> NodeData:
+def customize_typedef_decl(cursor: clang.Cursor, kwargs: NodeData, tokens: TokenTable) -> NodeData:
     """
     Sets the label of a typedef to its underlying type. Without this customization the label would be the name of the
     typedef which is not representative of possible changes to the typedef.
@@ -305,13 +623,13 @@ clang_literals = [
 
 
 @ClangParser.register_customizer(*clang_literals)
-def customize_literals(cursor: clang.Cursor, kwargs: NodeData) -> NodeData:
+def customize_literals(cursor: clang.Cursor, kwargs: NodeData, tokens: TokenTable) -> NodeData:
     """
     Sets the label to the token value of the literal. Without this customization a literal would not have a label at
     all.
     """
     try:
-        kwargs['label'] = ''.join(map(lambda x: x.spelling, cursor.get_tokens()))
+        kwargs['label'] = ''.join(t[2] for t in tokens.tokens(cursor))
     except AttributeError:
         raise parse.ParseError("Unexpected error: literal does not have any tokens.")
     return kwargs
@@ -326,34 +644,29 @@ clang_operators = [
 
 
 @ClangParser.register_customizer(*clang_operators)
-def customize_operator(cursor: clang.Cursor, kwargs: NodeData) -> NodeData:
+def customize_operator(cursor: clang.Cursor, kwargs: NodeData, tokens: TokenTable) -> NodeData:
     """
     Sets the label and location to that of the actual operator token. Without this customization an operator would not
     have a label. The libclang library does not expose the proper function for this.
     """
     # Get all tokens
-    tokens = {f"{t.location.line}:{t.location.column}:{t.spelling}": t for t in cursor.get_tokens()}
+    operator_tokens = {f"{line}:{column}:{spelling}": spelling for line, column, spelling in tokens.tokens(cursor)}
 
     # Remove tokens of children to be left with the actual operator token(s)
     for child in cursor.get_children():
-        for key in (f"{t.location.line}:{t.location.column}:{t.spelling}" for t in child.get_tokens()):
-            tokens.pop(key, None)
+        for key in (f"{line}:{column}:{spelling}" for line, column, spelling in tokens.tokens(child)):
+            operator_tokens.pop(key, None)
 
-    # if len(tokens) < 1:
+    # if len(operator_tokens) < 1:
     #     raise parse.ParseError("Unexpected error: Operator does not have any non-child tokens.")
 
-    # Get token objects ordered properly
-    tokens = list(map(lambda y: y[1], sorted(tokens.items(), key=lambda x: x[0])))
-
-    # if len(tokens) > 0:
-    #     kwargs['source_range'] = ir.Range(ClangParser.get_location(tokens[0]), ClangParser.get_location(tokens[-1]))
-
-    kwargs['label'] = ''.join(map(lambda x: x.spelling, tokens))
+    # Get tokens ordered properly
+    kwargs['label'] = ''.join(map(lambda x: x[1], sorted(operator_tokens.items(), key=lambda x: x[0])))
     return kwargs
 
 
 @ClangParser.register_customizer(clang.CursorKind.RETURN_STMT)
-def customize_return(cursor: clang.Cursor, kwargs: NodeData) -> NodeData:
+def customize_return(cursor: clang.Cursor, kwargs: NodeData, tokens: TokenTable) -> NodeData:
     """
     Sets the `is_memory_operation` flag for returns.
     """
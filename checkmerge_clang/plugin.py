@@ -1,5 +1,9 @@
 from checkmerge import plugins
-from checkmerge_clang.clang import configure
+
+
+#: Key, name and description of the provided parser.
+CLANG_PARSER = plugins.ClassInfo('clang', "Clang",
+                                 "Parser using the Clang compiler. See documentation for specific requirements.")
 
 
 class ClangPlugin(plugins.Plugin):
@@ -10,10 +14,12 @@ class ClangPlugin(plugins.Plugin):
     name = "Clang support"
     description = "Provides support for the C language through libclang."
 
-    def provide_parsers(self):
-        from checkmerge_clang.parse import ClangParser
-        return [ClangParser]
+    declared_parsers = [
+        plugins.Declaration.of('checkmerge_clang.parse:ClangParser', CLANG_PARSER),
+    ]
 
     def setup(self):
+        # Finding libclang is deferred until the parser is used
+        from checkmerge_clang.clang import configure
         configure()
         super(ClangPlugin, self).setup()
@@ -1,14 +1,28 @@
 import collections
+import mmap
+import struct
+import sys
 import typing
 
 import yaml
 
 from checkmerge import ir
-from checkmerge_llvm.checkmerge_llvm import get_analysis_file
+from checkmerge_llvm.checkmerge_llvm import get_analysis_file, BINARY_EXTENSION
 
 
 # Define stream type
 Stream = typing.Union[typing.AnyStr, typing.IO]
+Buffer = typing.Union[bytes, bytearray, memoryview, mmap.mmap]
+
+# Dependency kinds emitted by CheckMerge-LLVM and their IR dependency types
+DEPENDENCY_TYPES: typing.Dict[str, ir.DependencyType] = {
+    'RAW': ir.DependencyType.FLOW,
+    'WAR': ir.DependencyType.ANTI,
+    'WAW': ir.DependencyType.OUTPUT,
+    'RAR': ir.DependencyType.INPUT,
+    'RAU': ir.DependencyType.FLOW,
+    'WAU': ir.DependencyType.ANTI,
+}
 
 
 class SourceReference(object):
@@ -65,15 +79,20 @@ class AnalysisParser(object):
         parser = cls()
         return set(parser._parse(stream))
 
-    def _parse(self, stream: Stream) -> typing.Generator[AnalysisNode, None, None]:
-        # Get pure Python
-        raw = self._read(stream)
+    @classmethod
+    def iterparse(cls, stream: Stream) -> typing.Generator[AnalysisNode, None, None]:
+        """
+        Parses the LLVM analysis information function by function. The nodes of a function are generated as soon as the
+        function has been read, so only a single function is held in memory at any time.
 
-        # Check data structures
-        assert isinstance(raw, dict)
+        :param stream: A string or file-like object containing the data.
+        :return: Generator for the parsed nodes.
+        """
+        return cls()._parse(stream)
 
-        # Visit functions
-        for function in raw.items():
+    def _parse(self, stream: Stream) -> typing.Generator[AnalysisNode, None, None]:
+        # Visit functions as they are read
+        for function in self._read_functions(stream):
             yield from self._visit_function(*function)
 
     def _visit_function(self, name, data) -> typing.Generator[AnalysisNode, None, None]:
@@ -94,12 +113,10 @@ class AnalysisParser(object):
             entity_name=data['name']
         ))
 
-        # Filter out blocks
-        blocks = {k: v for k, v in data.items() if isinstance(k, str) and k.startswith('block.')}
-
-        # Visit children
-        for block in blocks.items():
-            yield from self._visit_block(*block)
+        # Visit blocks
+        for key, value in data.items():
+            if isinstance(key, str) and key.startswith('block.'):
+                yield from self._visit_block(key, value)
 
         # Resolve dependencies
         self._resolve_dependencies()
@@ -163,20 +180,7 @@ class AnalysisParser(object):
         for dependant, dependencies in data.items():
             for ref, typ in dependencies:
                 dependency = lookup.get(ref)
-                dependency_type = ir.DependencyType.OTHER
-
-                if typ == "RAW":
-                    dependency_type = ir.DependencyType.FLOW
-                elif typ == "WAR":
-                    dependency_type = ir.DependencyType.ANTI
-                elif typ == "WAW":
-                    dependency_type = ir.DependencyType.OUTPUT
-                elif typ == "RAR":
-                    dependency_type = ir.DependencyType.INPUT
-                elif typ == "RAU":
-                    dependency_type = ir.DependencyType.FLOW
-                elif typ == "WAU":
-                    dependency_type = ir.DependencyType.ANTI
+                dependency_type = DEPENDENCY_TYPES.get(typ, ir.DependencyType.OTHER)
 
                 if dependency:
                     assert isinstance(dependency, AnalysisNode)
@@ -189,21 +193,343 @@ class AnalysisParser(object):
         native = hasattr(yaml, 'CLoader')
         self._Loader = yaml.CLoader if native else yaml.Loader
 
-    def _read(self, stream: Stream):
+    def _read_functions(self, stream: Stream) -> typing.Generator[typing.Tuple[typing.Any, typing.Any], None, None]:
         """
-        Parses the input data and returns its pure Python representation.
+        Parses the input data function by function using the event API of the YAML parser. Only the function being
+        generated is converted to its pure Python representation.
 
         :param stream: The input data as string or file-like object.
-        :return: The pure Python representation of the data.
+        :return: Generator for the keys and pure Python representations of the functions.
         """
         if not self._Loader:
             raise AssertionError("The YAML loader has not been correctly initialized.")
-        return yaml.load(stream, Loader=self._Loader)
+
+        loader = self._Loader(stream)
+
+        try:
+            # Check data structures
+            loader.get_event()
+            assert loader.check_event(yaml.DocumentStartEvent)
+            loader.get_event()
+            assert loader.check_event(yaml.MappingStartEvent)
+            loader.get_event()
+
+            # Anchors are valid for the entire document
+            anchors = {}
+
+            while not loader.check_event(yaml.MappingEndEvent):
+                name = loader.construct_document(self._compose(loader, anchors))
+                data = loader.construct_document(self._compose(loader, anchors))
+                yield name, data
+        finally:
+            loader.dispose()
+
+    @classmethod
+    def _compose(cls, loader: yaml.BaseLoader, anchors: typing.Dict[str, yaml.Node]) -> yaml.Node:
+        """
+        Composes the representation graph of the next node from the parser events. This mirrors the composer of the YAML
+        library, which cannot be used for part of a document by the LibYAML implementation.
+        """
+        event = loader.get_event()
+
+        if isinstance(event, yaml.AliasEvent):
+            return anchors[event.anchor]
+
+        if isinstance(event, yaml.ScalarEvent):
+            tag = event.tag
+            if tag is None or tag == '!':
+                tag = loader.resolve(yaml.ScalarNode, event.value, event.implicit)
+            node = yaml.ScalarNode(tag, event.value, event.start_mark, event.end_mark, style=event.style)
+        elif isinstance(event, yaml.SequenceStartEvent):
+            tag = event.tag
+            if tag is None or tag == '!':
+                tag = loader.resolve(yaml.SequenceNode, None, event.implicit)
+            node = yaml.SequenceNode(tag, [], event.start_mark, None, flow_style=event.flow_style)
+            while not loader.check_event(yaml.SequenceEndEvent):
+                node.value.append(cls._compose(loader, anchors))
+            node.end_mark = loader.get_event().end_mark
+        else:
+            assert isinstance(event, yaml.MappingStartEvent)
+            tag = event.tag
+            if tag is None or tag == '!':
+                tag = loader.resolve(yaml.MappingNode, None, event.implicit)
+            node = yaml.MappingNode(tag, [], event.start_mark, None, flow_style=event.flow_style)
+            while not loader.check_event(yaml.MappingEndEvent):
+                key = cls._compose(loader, anchors)
+                node.value.append((key, cls._compose(loader, anchors)))
+            node.end_mark = loader.get_event().end_mark
+
+        if event.anchor is not None:
+            anchors[event.anchor] = node
+
+        return node
+
+
+class BinaryFormat(object):
+    """
+    Layout of the compact binary analysis format (`.ll.cmb`) of CheckMerge-LLVM.
+
+    All integers are unsigned and little endian. The file starts with a header, followed by these sections, which are
+    ordered such that every section is aligned to its item size and the file can be memory mapped and read in place:
+
+    - functions: per function the string ids of its name and file, its line and column, its first instruction and the
+      number of instructions (6 x u32);
+    - instructions: per instruction the string id of its file, its line and column, the string id of its variable name,
+      its first dependency edge and the number of edges (6 x u32);
+    - edge targets: per dependency the id of the instruction depended on (u32);
+    - string offsets: the start of every string in the string data, followed by the end of the last string (u32);
+    - edge types: per dependency its kind as index in `DEPENDENCY_KINDS` (u8);
+    - string data: the UTF-8 encoded strings.
+
+    Instruction ids are indices in the instruction section. A string id of `NONE` indicates absence, for an instruction
+    without location the file is `NONE`.
+    """
+    MAGIC = b'CMB\0'
+    VERSION = 1
+    NONE = 0xFFFFFFFF
+
+    # Magic, version, flags and the numbers of strings, functions, instructions and edges
+    header = struct.Struct('<4sHH4I')
+    record = struct.Struct('<6I')
+
+    # Dependency kinds by type byte, unknown kinds are stored as 0
+    DEPENDENCY_KINDS: typing.Tuple[str, ...] = ('', 'RAW', 'WAR', 'WAW', 'RAR', 'RAU', 'WAU')
+
+
+class BinaryAnalysisParser(BinaryFormat):
+    """
+    Reads the LLVM analysis information in the compact binary format into the same Python objects as the YAML based
+    `AnalysisParser`.
+    """
+    def __init__(self, buffer: Buffer):
+        """
+        :param buffer: The contents of the file, for example a memory map.
+        """
+        self._view = memoryview(buffer)
+
+        magic, version, _, strings, functions, instructions, edges = self.header.unpack_from(self._view)
+
+        if magic != self.MAGIC:
+            raise ValueError("The data is not in the CheckMerge-LLVM binary analysis format.")
+        if version != self.VERSION:
+            raise ValueError(f"Version {version} of the CheckMerge-LLVM binary analysis format is not supported.")
+
+        # Section views, read in place where possible
+        offset = self.header.size
+        self._functions, offset = self._section(offset, 6 * functions, 'I')
+        self._instructions, offset = self._section(offset, 6 * instructions, 'I')
+        self._edge_targets, offset = self._section(offset, edges, 'I')
+        string_offsets, offset = self._section(offset, strings + 1, 'I')
+        self._edge_types, offset = self._section(offset, edges, 'B')
+
+        data = self._view[offset:]
+        self._strings: typing.List[str] = [str(data[string_offsets[k]:string_offsets[k + 1]], 'utf-8')
+                                           for k in range(strings)]
+
+    def _section(self, offset: int, count: int, fmt: str) -> typing.Tuple[typing.Sequence[int], int]:
+        """Returns a view of an array of the given item format at the offset, and the offset after the array."""
+        size = struct.calcsize(fmt)
+        end = offset + count * size
+        view = self._view[offset:end].cast(fmt)
+        if size > 1 and sys.byteorder != 'little':
+            view = [struct.unpack_from(f'<{fmt}', self._view, k)[0] for k in range(offset, end, size)]
+        return view, end
+
+    @classmethod
+    def parse(cls, stream: typing.Union[Buffer, typing.BinaryIO]) -> typing.Set[AnalysisNode]:
+        """
+        Parses the binary LLVM analysis information into the appropriate Python data structures.
+
+        :param stream: The binary data or a binary file-like object, which is memory mapped when backed by a file.
+        :return: List of the parsed root nodes.
+        """
+        if hasattr(stream, 'fileno'):
+            with mmap.mmap(stream.fileno(), 0, access=mmap.ACCESS_READ) as buffer:
+                parser = cls(buffer)
+                try:
+                    return set(parser._parse())
+                finally:
+                    parser._release()
+        return set(cls(stream)._parse())
+
+    def _release(self):
+        """Releases the views on the buffer so that it can be closed."""
+        for view in (self._functions, self._instructions, self._edge_targets, self._edge_types, self._view):
+            if isinstance(view, memoryview):
+                view.release()
+
+    def _parse(self) -> typing.Generator[AnalysisNode, None, None]:
+        strings, functions, instructions = self._strings, self._functions, self._instructions
+        none = self.NONE
+        kinds = [DEPENDENCY_TYPES.get(kind, ir.DependencyType.OTHER) for kind in self.DEPENDENCY_KINDS]
+        locations: typing.Dict[typing.Tuple[int, int, int], ir.Location] = {}
+
+        def location(file: int, line: int, column: int) -> typing.Optional[ir.Location]:
+            if file == none:
+                return None
+            key = (file, line, column)
+            if key not in locations:
+                locations[key] = ir.Location(strings[file], line, column)
+            return locations[key]
+
+        for f in range(0, len(functions), 6):
+            name, file, line, column, first, count = functions[f:f + 6]
+            yield AnalysisNode(SourceReference(location=location(file, line, column), entity_name=strings[name]))
+
+            # Create instructions of the function
+            nodes = []
+            for i in range(6 * first, 6 * (first + count), 6):
+                file, line, column, variable = instructions[i:i + 4]
+                nodes.append(AnalysisNode(SourceReference(
+                    entity_name=strings[variable] if variable != none else None,
+                    location=location(file, line, column),
+                )))
+
+            # Resolve dependencies, which are always within the function
+            for node, i in zip(nodes, range(6 * first, 6 * (first + count), 6)):
+                edge, edges = instructions[i + 4:i + 6]
+                for e in range(edge, edge + edges):
+                    node.dependencies.add((nodes[self._edge_targets[e] - first], kinds[self._edge_types[e]]))
+
+            yield from nodes
+
+
+class BinaryAnalysisWriter(BinaryFormat):
+    """
+    Writes LLVM analysis information in the YAML format of CheckMerge-LLVM to the compact binary format. The LLVM pass
+    writes the binary format directly, this writer allows converting existing analysis files.
+    """
+    def __init__(self):
+        self._strings: typing.Dict[str, int] = {}
+        self._functions: typing.List[typing.Tuple[int, ...]] = []
+        self._instructions: typing.List[typing.Tuple[int, ...]] = []
+        self._edge_targets: typing.List[int] = []
+        self._edge_types = bytearray()
+        self._kinds = {kind: k for k, kind in enumerate(self.DEPENDENCY_KINDS)}
+
+    @classmethod
+    def convert(cls, stream: Stream, out: typing.BinaryIO) -> None:
+        """
+        Converts analysis information in the YAML format to the binary format.
+
+        :param stream: A string or file-like object containing the YAML data.
+        :param out: The binary file-like object to write to.
+        """
+        writer = cls()
+        for function in AnalysisParser()._read_functions(stream):
+            writer.add_function(*function)
+        writer.write(out)
+
+    def _string(self, value: typing.Optional[str]) -> int:
+        if value is None:
+            return self.NONE
+        return self._strings.setdefault(value, len(self._strings))
+
+    def _location(self, value: typing.Optional[str]) -> typing.Tuple[int, int, int]:
+        location = ir.Location.parse(value) if value else None
+        if location is None:
+            return self.NONE, 0, 0
+        return self._string(location.file), location.line, location.column
+
+    def add_function(self, name: str, data: typing.Dict[str, typing.Any]) -> None:
+        """
+        Adds a function in the YAML data structure of CheckMerge-LLVM.
+
+        :param name: The key of the function.
+        :param data: The data of the function.
+        """
+        file = ir.Location.parse(data['location']).file
+        first = len(self._instructions)
+        refs: typing.Dict[str, int] = {}
+        instructions = []
+
+        # Number the instructions of the function, as dependencies may refer to later instructions
+        for key, block in data.items():
+            if isinstance(key, str) and key.startswith('block.'):
+                for item in block:
+                    (ref, instruction), = item.items()
+                    refs[ref] = first + len(instructions)
+                    instructions.append(instruction)
+
+        for instruction in instructions:
+            location = instruction.get('location')
+            variable = instruction.get('variable') or {}
+
+            if not location and variable:
+                location = variable.get('location')
+
+            if location and location.startswith(':'):
+                location = file + location
+
+            # Dependencies on unknown instructions are dropped, as does the YAML parser
+            edge = len(self._edge_targets)
+            for ref, kind in (instruction.get('dependencies') or {}).items():
+                if isinstance(ref, str) and ref.startswith('*') and ref[1:] in refs:
+                    self._edge_targets.append(refs[ref[1:]])
+                    self._edge_types.append(self._kinds.get(kind, 0))
+
+            self._instructions.append((*self._location(location), self._string(variable.get('name')), edge,
+                                       len(self._edge_targets) - edge))
+
+        self._functions.append((self._string(data['name']), *self._location(data['location']), first,
+                                len(instructions)))
+
+    def write(self, out: typing.BinaryIO) -> None:
+        """
+        Writes the added functions in the binary format.
+
+        :param out: The binary file-like object to write to.
+        """
+        strings = [value.encode('utf-8') for value in self._strings]
+        offsets = [0]
+        for value in strings:
+            offsets.append(offsets[-1] + len(value))
+
+        out.write(self.header.pack(self.MAGIC, self.VERSION, 0, len(strings), len(self._functions),
+                                   len(self._instructions), len(self._edge_targets)))
+        for record in self._functions:
+            out.write(self.record.pack(*record))
+        for record in self._instructions:
+            out.write(self.record.pack(*record))
+        out.write(struct.pack(f'<{len(self._edge_targets)}I', *self._edge_targets))
+        out.write(struct.pack(f'<{len(offsets)}I', *offsets))
+        out.write(bytes(self._edge_types))
+        out.write(b''.join(strings))
+
+
+def parse_file(path: str) -> typing.Set[AnalysisNode]:
+    """
+    Parses an analysis file in either the binary or the YAML format, depending on its extension.
+
+    :param path: The path of the analysis file.
+    :return: List of the parsed root nodes.
+    """
+    if path.endswith(BINARY_EXTENSION):
+        with open(path, 'rb') as f:
+            return BinaryAnalysisParser.parse(f)
+    with open(path) as f:
+        return AnalysisParser.parse(f)
+
+
+def parse_bytes(data: Buffer) -> typing.Set[AnalysisNode]:
+    """
+    Parses analysis information held in memory in either the binary or the YAML format, depending on its header.
+
+    :param data: The contents of an analysis file.
+    :return: List of the parsed root nodes.
+    """
+    if bytes(data[:len(BinaryFormat.MAGIC)]) == BinaryFormat.MAGIC:
+        return BinaryAnalysisParser.parse(data)
+    return AnalysisParser.parse(str(data, 'utf-8'))
 
 
 __all__ = [
     SourceReference,
     AnalysisNode,
     AnalysisParser,
+    BinaryAnalysisParser,
+    BinaryAnalysisWriter,
     get_analysis_file,
+    parse_file,
+    parse_bytes,
 ]
@@ -1,8 +1,14 @@
 import ctypes.util
+import os
 import platform
 from ctypes import cdll
 
 
+# Extensions of the analysis files written by CheckMerge-LLVM
+YAML_EXTENSION = '.ll.cm'
+BINARY_EXTENSION = '.ll.cmb'
+
+
 def get_library() -> str:
     """
     Finds, loads and returns a reference to the CheckMerge-LLVM library.
@@ -33,17 +39,20 @@ def get_library() -> str:
         else:
             return lib._name
 
-    for name in names:
-        lib = ctypes.util.find_library(name)
-        if lib:
-            return lib
+    # The library search takes names without prefix and extension
+    lib = ctypes.util.find_library('CheckMerge-LLVM')
+    if lib:
+        return lib
 
-    raise EnvironmentError("The clang shared library does not appear to be present in this environment.")
+    raise EnvironmentError("The CheckMerge-LLVM shared library does not appear to be present in this environment.")
 
 
 def get_analysis_file(filename: str) -> str:
     """
     :param filename: The name of the file containing the source code.
-    :return: The expected name of the file containing the analysis.
+    :return: The expected name of the file containing the analysis. The binary format is preferred when present.
     """
-    return filename.rsplit('.', 1)[0] + '.ll.cm'
+    base = filename.rsplit('.', 1)[0]
+    if os.path.isfile(base + BINARY_EXTENSION):
+        return base + BINARY_EXTENSION
+    return base + YAML_EXTENSION
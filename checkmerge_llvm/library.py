@@ -0,0 +1,120 @@
+import ctypes
+import typing
+
+from checkmerge_llvm.analysis import AnalysisNode, BinaryAnalysisParser
+
+
+class LibraryError(Exception):
+    """Error reported by the CheckMerge-LLVM library."""
+
+
+class Library(object):
+    """
+    Bindings to the C API of the CheckMerge-LLVM library, which compiles code to an LLVM module and runs the CheckMerge
+    analysis pass on it within this process. No textual IR or analysis files are written and no processes are started.
+
+    The C API consists of the following functions:
+
+        int checkmerge_analyze_file(const char *path, const char *const *args, int num_args,
+                                    void **data, size_t *size, char **error);
+        int checkmerge_analyze_buffer(const char *path, const char *code, size_t code_size,
+                                      const char *const *args, int num_args,
+                                      void **data, size_t *size, char **error);
+        void checkmerge_free(void *ptr);
+
+    The analysis functions compile the file on the given path, or the code held in memory that is attributed to the
+    path, with the given compiler arguments. They return zero on success, in which case the analysis is returned as a
+    buffer in the binary analysis format (see `BinaryFormat`), which consists of flat arrays. Otherwise a message is
+    returned as error. Returned buffers and messages are released with `checkmerge_free`.
+
+    The LLVM pass library that `opt` loads does not implement this API yet, so the bindings are only used for a library
+    that is configured explicitly (see `ClangParser`).
+    """
+
+    def __init__(self, lib: typing.Any, path: typing.Optional[str] = None):
+        """
+        :param lib: The loaded library, see `load()`.
+        :param path: The path of the library.
+        """
+        self.path = path
+
+        args = (ctypes.POINTER(ctypes.c_char_p), ctypes.c_int, ctypes.POINTER(ctypes.c_void_p),
+                ctypes.POINTER(ctypes.c_size_t), ctypes.POINTER(ctypes.c_void_p))
+
+        self._analyze_file = lib.checkmerge_analyze_file
+        self._analyze_file.argtypes = (ctypes.c_char_p, *args)
+        self._analyze_file.restype = ctypes.c_int
+
+        self._analyze_buffer = lib.checkmerge_analyze_buffer
+        self._analyze_buffer.argtypes = (ctypes.c_char_p, ctypes.c_char_p, ctypes.c_size_t, *args)
+        self._analyze_buffer.restype = ctypes.c_int
+
+        self._free = lib.checkmerge_free
+        self._free.argtypes = (ctypes.c_void_p,)
+        self._free.restype = None
+
+    @classmethod
+    def load(cls, path: str) -> "Library":
+        """
+        Loads a CheckMerge-LLVM library providing the C API. The LLVM pass library found by `get_library()`, which is
+        loaded into `opt`, does not provide it, so the path is always given explicitly.
+
+        :param path: The path of the library.
+        :return: The bindings to the library.
+        """
+        try:
+            return cls(ctypes.cdll.LoadLibrary(path), path)
+        except AttributeError:
+            raise EnvironmentError(f"The CheckMerge-LLVM library {path} does not provide the C API.")
+
+    def analyze(self, path: str, content: typing.Optional[bytes] = None, args: typing.Sequence[str] = ()) \
+            -> typing.Set[AnalysisNode]:
+        """
+        Analyzes a file, or code held in memory that is attributed to the given path.
+
+        :param path: The path of the file.
+        :param content: The code, or `None` to read the code from the file.
+        :param args: The compiler arguments.
+        :return: The parsed root nodes of the analysis.
+        """
+        argv = (ctypes.c_char_p * len(args))(*(arg.encode('utf-8') for arg in args))
+        data, size, error = ctypes.c_void_p(), ctypes.c_size_t(), ctypes.c_void_p()
+        out = (ctypes.byref(data), ctypes.byref(size), ctypes.byref(error))
+
+        if content is None:
+            status = self._analyze_file(path.encode('utf-8'), argv, len(args), *out)
+        else:
+            status = self._analyze_buffer(path.encode('utf-8'), content, len(content), argv, len(args), *out)
+
+        try:
+            if status != 0:
+                message = ctypes.string_at(error.value).decode('utf-8', errors='replace') if error.value else ''
+                raise LibraryError(message or f"The analysis failed with status {status}.")
+            # The strings are copied by the parser, so the buffer is only needed while parsing
+            return BinaryAnalysisParser.parse(ctypes.string_at(data.value, size.value))
+        finally:
+            for pointer in (data, error):
+                if pointer.value:
+                    self._free(pointer)
+
+
+# The libraries of the process by their path, loaded on first use
+_libraries: typing.Dict[str, typing.Union[Library, EnvironmentError]] = {}
+
+
+def load_library(path: str) -> Library:
+    """
+    Loads the CheckMerge-LLVM library on the given path once per process.
+
+    :param path: The path of the library.
+    :return: The bindings to the library.
+    """
+    if path not in _libraries:
+        try:
+            _libraries[path] = Library.load(path)
+        except EnvironmentError as e:
+            _libraries[path] = e
+    library = _libraries[path]
+    if isinstance(library, EnvironmentError):
+        raise library
+    return library
@@ -1,6 +1,8 @@
+import io
+import tempfile
 import unittest
 
-from checkmerge_llvm.analysis import AnalysisParser
+from checkmerge_llvm.analysis import AnalysisParser, BinaryAnalysisParser, BinaryAnalysisWriter, parse_file
 
 
 class SimpleIRParseTestCase(unittest.TestCase):
@@ -51,9 +53,45 @@ function.main:
 
     def test_read(self):
         parser = AnalysisParser()
-        data = parser._read(self.text)
+        data = dict(parser._read_functions(self.text))
         self.assertEqual(self.data, data)
 
     def test_parse(self):
         nodes = AnalysisParser.parse(self.text)
         self.assertEqual(4, len(nodes))
+
+    def test_read_functions(self):
+        parser = AnalysisParser()
+        text = self.text + self.text.replace('function.main', 'function.other').replace('"main"', '"other"')
+        self.assertEqual(['function.main', 'function.other'], [name for name, _ in parser._read_functions(text)])
+        self.assertEqual(8, len(list(AnalysisParser.iterparse(text))))
+
+
+class BinaryIRParseTestCase(unittest.TestCase):
+    """
+    Tests the conversion to and parsing of the binary analysis format.
+    """
+    def setUp(self):
+        stream = io.BytesIO()
+        BinaryAnalysisWriter.convert(SimpleIRParseTestCase.text, stream)
+        self.data = stream.getvalue()
+
+    @staticmethod
+    def describe(nodes):
+        lookup = {id(n): (str(n.reference.entity_name), str(n.reference.location)) for n in nodes}
+        return sorted((lookup[id(n)], sorted((lookup[id(d)], t.name) for d, t in n.dependencies)) for n in nodes)
+
+    def test_parse(self):
+        nodes = BinaryAnalysisParser.parse(self.data)
+        self.assertEqual(4, len(nodes))
+        self.assertEqual(self.describe(AnalysisParser.parse(SimpleIRParseTestCase.text)), self.describe(nodes))
+
+    def test_parse_file(self):
+        with tempfile.NamedTemporaryFile(suffix='.ll.cmb') as f:
+            f.write(self.data)
+            f.flush()
+            self.assertEqual(self.describe(BinaryAnalysisParser.parse(self.data)), self.describe(parse_file(f.name)))
+
+    def test_invalid(self):
+        with self.assertRaises(ValueError):
+            BinaryAnalysisParser.parse(b'CM\0\0' + self.data[4:])
@@ -0,0 +1,75 @@
+import ctypes
+import unittest
+
+from checkmerge_llvm.analysis import AnalysisParser
+from checkmerge_llvm.library import Library, LibraryError
+from checkmerge_llvm.tests import test_analysis
+
+
+class FakeLibrary(object):
+    """
+    Implementation of the C API of the CheckMerge-LLVM library in Python, which returns the same analysis for every
+    file and fails for files named `error.c`.
+    """
+    analyze_file_type = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_int,
+                                         ctypes.POINTER(ctypes.c_void_p), ctypes.POINTER(ctypes.c_size_t),
+                                         ctypes.POINTER(ctypes.c_void_p))
+    analyze_buffer_type = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_size_t,
+                                           ctypes.POINTER(ctypes.c_char_p), ctypes.c_int,
+                                           ctypes.POINTER(ctypes.c_void_p), ctypes.POINTER(ctypes.c_size_t),
+                                           ctypes.POINTER(ctypes.c_void_p))
+    free_type = ctypes.CFUNCTYPE(None, ctypes.c_void_p)
+
+    def __init__(self, data: bytes):
+        self.calls = []
+        self.buffers = {}
+
+        def allocate(value: bytes) -> int:
+            buffer = ctypes.create_string_buffer(value, len(value) + 1)
+            self.buffers[ctypes.addressof(buffer)] = buffer
+            return ctypes.addressof(buffer)
+
+        def analyze(path, args, num_args, out, size, error, code=None):
+            self.calls.append((path.decode(), [args[k].decode() for k in range(num_args)], code))
+            if path.endswith(b'error.c'):
+                error[0] = allocate(b"error.c:1:1: error: expected expression")
+                return 1
+            out[0], size[0] = allocate(data), len(data)
+            return 0
+
+        self.checkmerge_analyze_file = self.analyze_file_type(analyze)
+        self.checkmerge_analyze_buffer = self.analyze_buffer_type(
+            lambda path, code, code_size, *args: analyze(path, *args, code=code[:code_size]))
+        self.checkmerge_free = self.free_type(lambda pointer: self.buffers.pop(pointer))
+
+
+class LibraryTestCase(unittest.TestCase):
+    """
+    Tests the bindings to the C API of the CheckMerge-LLVM library.
+    """
+    def setUp(self):
+        binary = test_analysis.BinaryIRParseTestCase()
+        binary.setUp()
+        self.lib = FakeLibrary(binary.data)
+        self.library = Library(self.lib)
+        self.describe = test_analysis.BinaryIRParseTestCase.describe
+        self.expected = self.describe(AnalysisParser.parse(test_analysis.SimpleIRParseTestCase.text))
+
+    def test_analyze_file(self):
+        """Tests analyzing a file, which passes the compiler arguments and releases the returned buffer."""
+        nodes = self.library.analyze('mini.c', args=['-I/usr/include', '-DX=1'])
+        self.assertEqual(self.expected, self.describe(nodes))
+        self.assertEqual([('mini.c', ['-I/usr/include', '-DX=1'], None)], self.lib.calls)
+        self.assertEqual({}, self.lib.buffers)
+
+    def test_analyze_buffer(self):
+        """Tests analyzing code held in memory."""
+        nodes = self.library.analyze('mini.c', b'int main() { return 0; }')
+        self.assertEqual(self.expected, self.describe(nodes))
+        self.assertEqual([('mini.c', [], b'int main() { return 0; }')], self.lib.calls)
+
+    def test_error(self):
+        """Tests that errors of the library are raised with their message and released."""
+        with self.assertRaisesRegex(LibraryError, 'expected expression'):
+            self.library.analyze('error.c')
+        self.assertEqual({}, self.lib.buffers)